@@ -0,0 +1,506 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+#include "asset_pack.h"
+#include "output.h"
+#include "utils.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#  define ASSET_PACK_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#endif
+
+#ifdef _WIN32
+#  include <direct.h>
+#  include <process.h>
+#else
+#  include <unistd.h>
+#  include <sys/stat.h>
+#  include <sys/types.h>
+#endif
+
+namespace {
+	const char magic[4] = { 'E', 'A', 'P', '1' };
+
+	// magic, entry count, size of the names
+	const size_t header_size = 12;
+	// hash, name offset, name length, data offset, data size
+	const size_t entry_size = 20;
+
+	struct Entry {
+		uint32_t hash;
+		uint32_t name_offset;
+		uint32_t name_length;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	bool operator<(Entry const& entry, uint32_t hash) {
+		return entry.hash < hash;
+	}
+
+	std::string pack_path;
+	FileFinder::ProjectTree tree;
+	std::vector<Entry> entries;
+	const uint8_t* base = NULL;
+	size_t length = 0;
+	const char* names = NULL;
+
+	// Extracted files of this session, by path in the tree
+	std::map<std::string, std::string> extracted;
+	// Directory they are extracted to, empty before the first one
+	std::string extract_directory;
+
+	uint32_t Hash(const char* data, size_t length) {
+		uint32_t hash = 2166136261U;
+		for (size_t i = 0; i < length; ++i) {
+			hash ^= (uint8_t) data[i];
+			hash *= 16777619U;
+		}
+		return hash;
+	}
+
+	uint32_t Read32(const uint8_t* p) {
+		return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+	}
+
+	void Write32(std::vector<uint8_t>& out, uint32_t value) {
+		for (int i = 0; i < 4; ++i) {
+			out.push_back((uint8_t) (value >> (i * 8)));
+		}
+	}
+
+	struct PackedFile {
+		std::string name;
+		std::string path;
+		uint32_t size;
+	};
+
+	bool PackedFileLess(PackedFile const& a, PackedFile const& b) {
+		uint32_t const hash_a = Hash(a.name.data(), a.name.size());
+		uint32_t const hash_b = Hash(b.name.data(), b.name.size());
+		return hash_a != hash_b ? hash_a < hash_b : a.name < b.name;
+	}
+
+	/** Name of a path inside the pack, with / as separator. */
+	bool PackedName(const std::string& path, std::string& name) {
+		if (pack_path.empty() || path.size() <= pack_path.size() + 1 ||
+			path.compare(0, pack_path.size(), pack_path) != 0 ||
+			(path[pack_path.size()] != '/' && path[pack_path.size()] != '\\')) {
+			return false;
+		}
+
+		name = path.substr(pack_path.size() + 1);
+		std::replace(name.begin(), name.end(), '\\', '/');
+		return true;
+	}
+
+	Entry const* FindEntry(const std::string& name) {
+		uint32_t const hash = Hash(name.data(), name.size());
+		std::vector<Entry>::const_iterator it = std::lower_bound(entries.begin(), entries.end(), hash);
+		for (; it != entries.end() && it->hash == hash; ++it) {
+			if (it->name_length == name.size() &&
+				memcmp(names + it->name_offset, name.data(), name.size()) == 0) {
+				return &*it;
+			}
+		}
+		return NULL;
+	}
+
+	void AddToTree(const std::string& name) {
+		// Same layout as FileFinder::CreateProjectTree: top level files and
+		// directories, and every file below a top level directory
+		std::string::size_type const slash = name.find('/');
+		if (slash == std::string::npos) {
+			tree.files[Utils::LowerCase(name)] = name;
+			return;
+		}
+
+		std::string const dir = name.substr(0, slash);
+		// Platform separators like GetDirectoryMembers
+		std::string const member = FileFinder::MakePath("", name.substr(slash + 1));
+		tree.directories[Utils::LowerCase(dir)] = dir;
+		tree.sub_members[Utils::LowerCase(dir)][Utils::LowerCase(member)] = member;
+	}
+
+	bool Map(const std::string& path) {
+#ifdef ASSET_PACK_MMAP
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat sb;
+		if (fstat(fd, &sb) != 0 || sb.st_size < (off_t) header_size) {
+			close(fd);
+			return false;
+		}
+
+		void* data = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED)
+			return false;
+
+		base = (const uint8_t*) data;
+		length = sb.st_size;
+		return true;
+#else
+		FILE* stream = FileFinder::fopenUTF8(path, "rb");
+		if (!stream)
+			return false;
+
+		fseek(stream, 0, SEEK_END);
+		long size = ftell(stream);
+		fseek(stream, 0, SEEK_SET);
+
+		void* data = size >= (long) header_size ? malloc(size) : NULL;
+		if (data && fread(data, 1, size, stream) != (size_t) size) {
+			free(data);
+			data = NULL;
+		}
+		fclose(stream);
+		if (!data)
+			return false;
+
+		base = (const uint8_t*) data;
+		length = size;
+		return true;
+#endif
+	}
+
+	void Unmap() {
+		if (!base)
+			return;
+#ifdef ASSET_PACK_MMAP
+		munmap((void*) base, length);
+#else
+		free((void*) base);
+#endif
+		base = NULL;
+		length = 0;
+	}
+
+	bool ReadEntries() {
+		if (memcmp(base, magic, sizeof(magic)) != 0)
+			return false;
+
+		uint32_t const count = Read32(base + 4);
+		uint32_t const names_size = Read32(base + 8);
+		if (header_size + (uint64_t) count * entry_size + names_size > length)
+			return false;
+
+		names = (const char*) base + header_size + count * entry_size;
+		entries.reserve(count);
+		for (uint32_t i = 0; i < count; ++i) {
+			const uint8_t* p = base + header_size + i * entry_size;
+			Entry entry;
+			entry.hash = Read32(p);
+			entry.name_offset = Read32(p + 4);
+			entry.name_length = Read32(p + 8);
+			entry.offset = Read32(p + 12);
+			entry.size = Read32(p + 16);
+
+			if ((uint64_t) entry.name_offset + entry.name_length > names_size ||
+				(uint64_t) entry.offset + entry.size > length ||
+				entry.hash != Hash(names + entry.name_offset, entry.name_length) ||
+				(!entries.empty() && entries.back().hash > entry.hash)) {
+				return false;
+			}
+			entries.push_back(entry);
+		}
+		return true;
+	}
+
+	std::string ExtractDirectory() {
+		// Per process, another instance may run the same game
+#ifdef _WIN32
+		const char* temp = getenv("TEMP");
+		int const pid = _getpid();
+#else
+		const char* temp = getenv("TMPDIR");
+		int const pid = (int) getpid();
+#endif
+		if (!temp || !*temp) {
+#ifdef _WIN32
+			temp = ".";
+#else
+			temp = "/tmp";
+#endif
+		}
+
+		char name[32];
+		sprintf(name, "easyrpg-pack-%d", pid);
+		return FileFinder::MakePath(temp, name);
+	}
+
+	void MakeDirectory(const std::string& directory) {
+#ifdef _WIN32
+		_wmkdir(Utils::ToWideString(directory).c_str());
+#else
+		mkdir(directory.c_str(), 0755);
+#endif
+	}
+
+	// Only removes empty directories
+	void RemoveEmptyDirectory(const std::string& directory) {
+#ifdef _WIN32
+		_wrmdir(Utils::ToWideString(directory).c_str());
+#else
+		rmdir(directory.c_str());
+#endif
+	}
+
+	// Resolves "." and ".." and links, paths that do not exist are kept
+	std::string CanonicalPath(const std::string& path) {
+#ifdef _WIN32
+		wchar_t full[_MAX_PATH];
+		if (_wfullpath(full, Utils::ToWideString(path).c_str(), _MAX_PATH))
+			return Utils::FromWideString(full);
+#else
+		char* full = realpath(path.c_str(), NULL);
+		if (full) {
+			std::string const result(full);
+			free(full);
+			return result;
+		}
+#endif
+		return path;
+	}
+
+	bool WriteEntry(Entry const& entry, const std::string& target) {
+		FILE* stream = FileFinder::fopenUTF8(target, "wb");
+		bool ok = stream && fwrite(base + entry.offset, 1, entry.size, stream) == entry.size;
+		ok = stream && fclose(stream) == 0 && ok;
+		if (!ok)
+			remove(target.c_str());
+		return ok;
+	}
+}
+
+bool AssetPack::Create(const std::string& directory, const std::string& pack_file) {
+	if (!(FileFinder::Exists(directory) && FileFinder::IsDirectory(directory))) {
+		Output::Warning("Asset pack: %s is not a directory", directory.c_str());
+		return false;
+	}
+
+	FileFinder::Directory const members = FileFinder::GetDirectoryMembers(directory, FileFinder::RECURSIVE);
+
+	std::string const temp_file = pack_file + ".tmp";
+	std::string const canonical_pack = CanonicalPath(pack_file);
+	std::string const canonical_temp = CanonicalPath(temp_file);
+
+	std::vector<PackedFile> files;
+	std::vector<uint8_t> out(magic, magic + sizeof(magic));
+	uint32_t names_size = 0;
+
+	for (FileFinder::string_map::const_iterator it = members.members.begin(); it != members.members.end(); ++it) {
+		PackedFile file;
+		file.name = it->second;
+		std::replace(file.name.begin(), file.name.end(), '\\', '/');
+		file.path = FileFinder::MakePath(directory, it->second);
+		std::string const canonical = CanonicalPath(file.path);
+		if (canonical == canonical_pack || canonical == canonical_temp) {
+			// Do not pack an older version of the pack itself
+			continue;
+		}
+
+		FILE* stream = FileFinder::fopenUTF8(file.path, "rb");
+		if (!stream) {
+			Output::Warning("Asset pack: Cannot read %s", file.path.c_str());
+			return false;
+		}
+		fseek(stream, 0, SEEK_END);
+		file.size = (uint32_t) ftell(stream);
+		fclose(stream);
+
+		files.push_back(file);
+		names_size += file.name.size();
+	}
+
+	std::sort(files.begin(), files.end(), PackedFileLess);
+
+	Write32(out, files.size());
+	Write32(out, names_size);
+
+	uint32_t name_offset = 0;
+	uint32_t offset = (header_size + files.size() * entry_size + names_size + 15) & ~15U;
+	for (std::vector<PackedFile>::const_iterator it = files.begin(); it != files.end(); ++it) {
+		Write32(out, Hash(it->name.data(), it->name.size()));
+		Write32(out, name_offset);
+		Write32(out, it->name.size());
+		Write32(out, offset);
+		Write32(out, it->size);
+		name_offset += it->name.size();
+		offset = (offset + it->size + 15) & ~15U;
+	}
+	for (std::vector<PackedFile>::const_iterator it = files.begin(); it != files.end(); ++it) {
+		out.insert(out.end(), it->name.begin(), it->name.end());
+	}
+	out.resize((out.size() + 15) & ~15U);
+
+	// An older pack stays intact until the new one is complete
+	FILE* pack = FileFinder::fopenUTF8(temp_file, "wb");
+	if (!pack) {
+		Output::Warning("Asset pack: Cannot write %s", temp_file.c_str());
+		return false;
+	}
+
+	bool ok = fwrite(&out[0], 1, out.size(), pack) == out.size();
+	std::vector<uint8_t> data;
+	for (std::vector<PackedFile>::const_iterator it = files.begin(); ok && it != files.end(); ++it) {
+		if (it->size == 0)
+			continue;
+
+		data.assign((it->size + 15) & ~15U, 0);
+
+		FILE* stream = FileFinder::fopenUTF8(it->path, "rb");
+		ok = stream && fread(&data[0], 1, it->size, stream) == it->size;
+		if (stream) {
+			fclose(stream);
+		}
+		ok = ok && fwrite(&data[0], 1, data.size(), pack) == data.size();
+	}
+	ok = fclose(pack) == 0 && ok;
+
+#ifdef _WIN32
+	// rename does not replace existing files
+	if (ok) {
+		remove(pack_file.c_str());
+	}
+#endif
+	ok = ok && rename(temp_file.c_str(), pack_file.c_str()) == 0;
+
+	if (!ok) {
+		Output::Warning("Asset pack: Writing %s failed", pack_file.c_str());
+		remove(temp_file.c_str());
+		return false;
+	}
+
+	Output::Debug("Asset pack: Packed %d files into %s", (int) files.size(), pack_file.c_str());
+	return true;
+}
+
+bool AssetPack::Mount(const std::string& pack_file) {
+	Unmount();
+
+	if (!Map(pack_file)) {
+		Output::Warning("Asset pack: Cannot open %s", pack_file.c_str());
+		return false;
+	}
+
+	if (!ReadEntries()) {
+		Output::Warning("Asset pack: %s is not a valid pack", pack_file.c_str());
+		entries.clear();
+		names = NULL;
+		Unmap();
+		return false;
+	}
+
+	// Tree paths are made with MakePath, keep the prefix comparable
+	pack_path = FileFinder::MakePath("", pack_file);
+	tree.project_path = pack_path;
+	for (std::vector<Entry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+		AddToTree(std::string(names + it->name_offset, it->name_length));
+	}
+	FileFinder::ClearLookups();
+
+	Output::Debug("Asset pack: Mounted %s with %d files", pack_file.c_str(), (int) entries.size());
+	return true;
+}
+
+void AssetPack::Unmount() {
+	if (!IsMounted())
+		return;
+
+	for (std::map<std::string, std::string>::const_iterator it = extracted.begin(); it != extracted.end(); ++it) {
+		remove(it->second.c_str());
+	}
+	if (!extract_directory.empty()) {
+		RemoveEmptyDirectory(extract_directory);
+	}
+	extracted.clear();
+	extract_directory.clear();
+
+	Unmap();
+	entries.clear();
+	names = NULL;
+	pack_path.clear();
+	FileFinder::ProjectTree empty;
+	tree = empty;
+	FileFinder::ClearLookups();
+}
+
+bool AssetPack::IsMounted() {
+	return base != NULL;
+}
+
+FileFinder::ProjectTree const& AssetPack::GetTree() {
+	return tree;
+}
+
+bool AssetPack::IsPacked(const std::string& path) {
+	std::string name;
+	return PackedName(path, name) && FindEntry(name) != NULL;
+}
+
+bool AssetPack::Find(const std::string& path, const uint8_t*& data, size_t& size) {
+	std::string name;
+	Entry const* entry = PackedName(path, name) ? FindEntry(name) : NULL;
+	if (!entry)
+		return false;
+
+	data = base + entry->offset;
+	size = entry->size;
+	return true;
+}
+
+std::string AssetPack::Extract(const std::string& path) {
+	std::string name;
+	Entry const* entry = PackedName(path, name) ? FindEntry(name) : NULL;
+	if (!entry)
+		return path;
+
+	std::map<std::string, std::string>::const_iterator it = extracted.find(name);
+	if (it != extracted.end())
+		return it->second;
+
+	if (extract_directory.empty()) {
+		extract_directory = ExtractDirectory();
+		MakeDirectory(extract_directory);
+	}
+
+	// Keep the extension, readers pick the format by it
+	char prefix[16];
+	sprintf(prefix, "%08x_", entry->hash);
+	std::string const filename = prefix + name.substr(name.rfind('/') + 1);
+
+	std::string const target = FileFinder::MakePath(extract_directory, filename);
+	if (!WriteEntry(*entry, target)) {
+		Output::Warning("Asset pack: Cannot extract %s", name.c_str());
+		return std::string();
+	}
+
+	extracted[name] = target;
+	return target;
+}
@@ -0,0 +1,105 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ASSET_PACK_H_
+#define _ASSET_PACK_H_
+
+// Headers
+#include <string>
+#include "system.h"
+#include "filefinder.h"
+
+/**
+ * AssetPack namespace.
+ * A pack holds all files of a game in one file: a header, a table of
+ * contents sorted by name hash, the names and the 16 byte aligned file
+ * data. A mounted pack replaces the project tree of FileFinder and is
+ * memory mapped where the platform supports it and read into memory
+ * otherwise, so images are decoded straight from the pack data.
+ * Files read by name, like the database, maps and audio, are extracted
+ * on first use into a temporary directory of the running process.
+ * All numbers are stored little endian, files are limited to 4 GiB.
+ */
+namespace AssetPack {
+	/**
+	 * Writes all files below a directory into a pack.
+	 *
+	 * @param directory directory to pack.
+	 * @param pack_file pack to create.
+	 * @return whether the pack was written.
+	 */
+	bool Create(const std::string& directory, const std::string& pack_file);
+
+	/**
+	 * Mounts a pack as the project tree, replacing a mounted one.
+	 *
+	 * @param pack_file pack to mount.
+	 * @return whether the pack is valid.
+	 */
+	bool Mount(const std::string& pack_file);
+
+	/**
+	 * Unmounts the pack and removes the extracted files.
+	 */
+	void Unmount();
+
+	/**
+	 * Gets whether a pack is mounted.
+	 *
+	 * @return whether a pack is mounted.
+	 */
+	bool IsMounted();
+
+	/**
+	 * Gets the project tree of the mounted pack. The paths of the tree
+	 * start with the path of the pack file.
+	 *
+	 * @return project tree.
+	 */
+	FileFinder::ProjectTree const& GetTree();
+
+	/**
+	 * Gets whether a path points into the mounted pack.
+	 *
+	 * @param path path from the project tree.
+	 * @return whether the path is inside the pack.
+	 */
+	bool IsPacked(const std::string& path);
+
+	/**
+	 * Gets the data of a packed file without copying it.
+	 * The data stays valid until the pack is unmounted.
+	 *
+	 * @param path path from the project tree.
+	 * @param data receives the file data.
+	 * @param size receives the file size.
+	 * @return whether the file is in the pack.
+	 */
+	bool Find(const std::string& path, const uint8_t*& data, size_t& size);
+
+	/**
+	 * Gets a real file with the contents of a packed file for readers
+	 * that open files by name. Paths outside of the pack are returned
+	 * unchanged.
+	 *
+	 * @param path path from the project tree.
+	 * @return path of a readable file, empty on failure.
+	 */
+	std::string Extract(const std::string& path);
+}
+
+#endif
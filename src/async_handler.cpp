@@ -15,16 +15,24 @@
  * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cstdlib>
+#include <deque>
 #include <map>
 #include "async_handler.h"
+#include "bitmap.h"
+#include "cache.h"
 #include "filefinder.h"
+#include "image_cache.h"
 #include "memory_management.h"
 #include "output.h"
 #include "player.h"
 
 #ifdef EMSCRIPTEN
 #include <emscripten.h>
+#elif defined(USE_SDL)
+#include <SDL.h>
+#include <SDL_thread.h>
 #endif
 
 namespace {
@@ -44,6 +52,139 @@ namespace {
 		async_requests[path] = request;
 	}
 
+	int thread_count = 2;
+
+#if defined(USE_SDL) && !defined(EMSCRIPTEN)
+	struct DecodeJob {
+		FileRequestAsync* request;
+		std::string directory;
+		std::string file;
+		std::string path;
+		bool transparent;
+		uint32_t flags;
+		bool decoded;
+		Bitmap::DecodedImage image;
+	};
+
+	std::vector<SDL_Thread*> workers;
+	SDL_mutex* mutex = NULL;
+	SDL_cond* job_ready = NULL;
+	// Guarded by mutex, a job belongs to the queue it is in
+	std::deque<DecodeJob*> queued;
+	// Prefetched files, only decoded when nothing else is queued
+	std::deque<DecodeJob*> queued_low;
+	std::deque<DecodeJob*> finished;
+	bool quit = false;
+
+	int WorkerMain(void*) {
+		SDL_LockMutex(mutex);
+		for (;;) {
+			while (!quit && queued.empty() && queued_low.empty())
+				SDL_CondWait(job_ready, mutex);
+			if (quit)
+				break;
+
+			std::deque<DecodeJob*>& queue = queued.empty() ? queued_low : queued;
+			DecodeJob* job = queue.front();
+			queue.pop_front();
+			SDL_UnlockMutex(mutex);
+
+			job->decoded = Bitmap::Decode(job->path, job->transparent, job->flags, job->image);
+
+			SDL_LockMutex(mutex);
+			finished.push_back(job);
+		}
+		SDL_UnlockMutex(mutex);
+
+		return 0;
+	}
+
+	void StartWorkers() {
+		mutex = SDL_CreateMutex();
+		job_ready = SDL_CreateCond();
+		quit = false;
+
+		for (int i = 0; i < thread_count; i++) {
+#if SDL_MAJOR_VERSION==1
+			SDL_Thread* thread = SDL_CreateThread(WorkerMain, NULL);
+#else
+			SDL_Thread* thread = SDL_CreateThread(WorkerMain, "load worker", NULL);
+#endif
+			if (thread == NULL) {
+				Output::Warning("Couldn't start load worker thread: %s", SDL_GetError());
+				break;
+			}
+			workers.push_back(thread);
+		}
+	}
+
+	/**
+	 * Decodes a requested image on a worker thread.
+	 *
+	 * @return false if the request must be finished right away.
+	 */
+	bool QueueDecode(FileRequestAsync* request, const std::string& directory, const std::string& file,
+					 bool low_priority) {
+		bool transparent;
+		uint32_t flags;
+
+		// Images in the image cache are mapped faster than a worker decodes them
+		if (thread_count < 1 || ImageCache::IsEnabled() ||
+			!Cache::GetImageParams(directory, transparent, flags)) {
+			return false;
+		}
+
+		// Resolving is a lookup in the project tree, only the file access is deferred
+		std::string const path = FileFinder::FindImage(directory, file);
+		if (path.empty()) {
+			return false;
+		}
+
+		if (!mutex) {
+			StartWorkers();
+		}
+		if (workers.empty()) {
+			return false;
+		}
+
+		DecodeJob* job = new DecodeJob();
+		job->request = request;
+		job->directory = directory;
+		job->file = file;
+		job->path = path;
+		job->transparent = transparent;
+		job->flags = flags;
+		job->decoded = false;
+
+		SDL_LockMutex(mutex);
+		(low_priority ? queued_low : queued).push_back(job);
+		SDL_CondSignal(job_ready);
+		SDL_UnlockMutex(mutex);
+
+		return true;
+	}
+
+	/**
+	 * Moves a prefetched request in front of the other prefetches when
+	 * it is needed now.
+	 */
+	void PromoteDecode(FileRequestAsync* request) {
+		if (!mutex) {
+			return;
+		}
+
+		SDL_LockMutex(mutex);
+		for (std::deque<DecodeJob*>::iterator it = queued_low.begin(); it != queued_low.end(); ++it) {
+			if ((*it)->request == request) {
+				queued.push_back(*it);
+				queued_low.erase(it);
+				break;
+			}
+		}
+		SDL_UnlockMutex(mutex);
+	}
+#endif
+
 #ifdef EMSCRIPTEN
 	void download_success(unsigned, void* userData, const char*) {
 		FileRequestAsync* req = static_cast<FileRequestAsync*>(userData);
@@ -80,6 +221,95 @@ FileRequestAsync* AsyncHandler::RequestFile(const std::string& file_name) {
 	return RequestFile(".", file_name);
 }
 
+void AsyncHandler::SetThreads(int threads) {
+	Quit();
+	thread_count = std::max(threads, 0);
+}
+
+bool AsyncHandler::LoadsInBackground() {
+#if defined(EMSCRIPTEN)
+	return true;
+#elif defined(USE_SDL)
+	// Same conditions as QueueDecode, workers are started on first use
+	return thread_count >= 1 && !ImageCache::IsEnabled() && (!mutex || !workers.empty());
+#else
+	return false;
+#endif
+}
+
+void AsyncHandler::Update() {
+#if defined(USE_SDL) && !defined(EMSCRIPTEN)
+	if (!mutex) {
+		return;
+	}
+
+	std::deque<DecodeJob*> done;
+	SDL_LockMutex(mutex);
+	done.swap(finished);
+	SDL_UnlockMutex(mutex);
+
+	for (std::deque<DecodeJob*>::iterator it = done.begin(); it != done.end(); ++it) {
+		DecodeJob* job = *it;
+
+		// Prefetches beyond what the cache holds are dropped before the
+		// bitmap is made, the file is decoded again when it is started
+		if (job->decoded &&
+			(size_t) job->image.width * job->image.height * 4 > Cache::GetPreloadRoom() &&
+			job->request->DropPrefetch()) {
+			free(job->image.pixels);
+			delete job;
+			continue;
+		}
+
+		// Held by the cache until the next load of the file takes it.
+		// Files the worker couldn't read are loaded and reported by the cache.
+		if (job->decoded) {
+			BitmapRef const bitmap = Bitmap::Create(job->path, job->image, job->transparent, job->flags);
+			Cache::AddPreloaded(job->directory, job->file, bitmap, job->transparent);
+		}
+
+		job->request->DownloadDone(true);
+		delete job;
+	}
+#endif
+}
+
+void AsyncHandler::Quit() {
+#if defined(USE_SDL) && !defined(EMSCRIPTEN)
+	if (!mutex) {
+		return;
+	}
+
+	SDL_LockMutex(mutex);
+	quit = true;
+	SDL_CondBroadcast(job_ready);
+	SDL_UnlockMutex(mutex);
+
+	for (std::vector<SDL_Thread*>::iterator it = workers.begin(); it != workers.end(); ++it) {
+		SDL_WaitThread(*it, NULL);
+	}
+	workers.clear();
+
+	// Shutting down, the listeners of unfinished requests are not called
+	queued.insert(queued.end(), queued_low.begin(), queued_low.end());
+	queued.insert(queued.end(), finished.begin(), finished.end());
+	queued_low.clear();
+	finished.clear();
+	for (std::deque<DecodeJob*>::iterator it = queued.begin(); it != queued.end(); ++it) {
+		if ((*it)->decoded) {
+			free((*it)->image.pixels);
+		}
+		delete *it;
+	}
+	queued.clear();
+
+	SDL_DestroyCond(job_ready);
+	SDL_DestroyMutex(mutex);
+	job_ready = NULL;
+	mutex = NULL;
+#endif
+}
+
 bool AsyncHandler::IsImportantFilePending() {
 	std::map<std::string, FileRequestAsync>::iterator it;
 
@@ -101,6 +331,7 @@ FileRequestAsync::FileRequestAsync(const std::string& folder_name, const std::st
 	file(file_name) {
 	this->path = path = FileFinder::MakePath(folder_name, file_name);
 	this->important = false;
+	this->prefetch = false;
 
 	state = State_WaitForStart;
 }
@@ -121,7 +352,24 @@ void FileRequestAsync::SetImportantFile(bool important) {
 }
 
 void FileRequestAsync::Start() {
+	StartRequest(false);
+}
+
+void FileRequestAsync::Prefetch() {
+	StartRequest(true);
+}
+
+void FileRequestAsync::StartRequest(bool low_priority) {
+	if (!low_priority) {
+		prefetch = false;
+	}
+
 	if (state == State_Pending) {
+#if defined(USE_SDL) && !defined(EMSCRIPTEN)
+		if (!low_priority) {
+			PromoteDecode(this);
+		}
+#endif
 		return;
 	}
 
@@ -132,6 +380,7 @@ void FileRequestAsync::Start() {
 	}
 
 	state = State_Pending;
+	prefetch = low_priority;
 
 #ifdef EMSCRIPTEN
 	std::string request_path = "games/?file=" + path;
@@ -149,6 +398,12 @@ void FileRequestAsync::Start() {
 		download_failure,
 		NULL);
 #else
+#  ifdef USE_SDL
+	if (QueueDecode(this, directory, file, low_priority)) {
+		return;
+	}
+#  endif
+
 	// add comment for fake download testing
 	DownloadDone(true);
 #endif
@@ -164,6 +419,17 @@ void FileRequestAsync::UpdateProgress() {
 #endif
 }
 
+bool FileRequestAsync::DropPrefetch() {
+	// Somebody waits for the file
+	if (!prefetch || !listeners.empty()) {
+		return false;
+	}
+
+	state = State_WaitForStart;
+	prefetch = false;
+	return true;
+}
+
 const std::string& FileRequestAsync::GetPath() const {
 	return path;
 }
@@ -199,12 +465,13 @@ void FileRequestAsync::CallListeners(bool success) {
 	result.file = file;
 	result.success = success;
 
-	std::vector<std::pair<int, boost::function<void(FileRequestResult*)> > >::iterator it;
-	for (it = listeners.begin(); it != listeners.end(); ++it) {
-		(it->second)(&result);
+	// Listeners may unbind others, e.g. by destroying their owner, so
+	// each one is removed before it is called
+	while (!listeners.empty()) {
+		boost::function<void(FileRequestResult*)> const listener = listeners.front().second;
+		listeners.erase(listeners.begin());
+		listener(&result);
 	}
-
-	listeners.clear();
 }
 
 void FileRequestAsync::DownloadDone(bool success) {
@@ -28,6 +28,7 @@ struct FileRequestResult;
 /**
  * AsyncHandler supports asynchronous file requests for platforms that don't
  * support synchronous IO (e.g. Emscripten).
+ * On other platforms requested images are decoded by worker threads.
  */
 namespace AsyncHandler {
 	/**
@@ -61,6 +62,34 @@ namespace AsyncHandler {
 	 * @return If any file with important-flag is pending.
 	 */
 	bool IsImportantFilePending();
+
+	/**
+	 * Sets the number of threads decoding requested images in the
+	 * background. 0 finishes requests right away on the main thread.
+	 * Only used on platforms with synchronous IO.
+	 *
+	 * @param threads number of worker threads.
+	 */
+	void SetThreads(int threads);
+
+	/**
+	 * Checks whether image requests finish in the background. Otherwise
+	 * starting a request loads the file right away.
+	 *
+	 * @return whether requests are loaded in the background.
+	 */
+	bool LoadsInBackground();
+
+	/**
+	 * Finishes requests the worker threads are done with.
+	 * Their event handlers are called on the calling thread.
+	 */
+	void Update();
+
+	/**
+	 * Stops the worker threads.
+	 */
+	void Quit();
 }
 
 /**
@@ -120,6 +149,13 @@ public:
 	 */
 	void Start();
 
+	/**
+	 * Starts the request like Start() for a file that is likely needed
+	 * soon. Where files are decoded in the background it waits until
+	 * no other request is pending. Calling Start() later moves it ahead.
+	 */
+	void Prefetch();
+
 	/**
 	 * @return Path to the requested file.
 	 */
@@ -165,7 +201,9 @@ public:
 	// don't call these directly
 	void DownloadDone(bool success);
 	void UpdateProgress();
+	bool DropPrefetch();
 private:
+	void StartRequest(bool low_priority);
 	void CallListeners(bool success);
 
 	std::vector<std::pair<int, boost::function<void(FileRequestResult*)> > > listeners;	
@@ -174,6 +212,8 @@ private:
 	std::string path;
 	int state;
 	bool important;
+	// Only prefetched, nobody called Start() yet
+	bool prefetch;
 };
 
 /**
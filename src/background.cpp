@@ -30,42 +30,44 @@
 Background::Background(const std::string& name) :
 	visible(true),
 	bg_hscroll(0), bg_vscroll(0), bg_x(0), bg_y(0),
-	fg_hscroll(0), fg_vscroll(0), fg_x(0), fg_y(0) {
+	fg_hscroll(0), fg_vscroll(0), fg_x(0), fg_y(0),
+	bg_request(NULL), fg_request(NULL) {
 
 	Graphics::RegisterDrawable(this);
 
-	FileRequestAsync* request = AsyncHandler::RequestFile("Backdrop", name);
-	request->Bind(&Background::OnBackgroundGraphicReady, this);
-	request->Start();
+	bg_request = AsyncHandler::RequestFile("Backdrop", name);
+	bg_request_id = bg_request->Bind(&Background::OnBackgroundGraphicReady, this);
+	bg_request->Start();
 }
 
 Background::Background(int terrain_id) :
 	visible(true),
 	bg_hscroll(0), bg_vscroll(0), bg_x(0), bg_y(0),
-	fg_hscroll(0), fg_vscroll(0), fg_x(0), fg_y(0) {
+	fg_hscroll(0), fg_vscroll(0), fg_x(0), fg_y(0),
+	bg_request(NULL), fg_request(NULL) {
 
 	Graphics::RegisterDrawable(this);
 
 	const RPG::Terrain& terrain = Data::terrains[terrain_id - 1];
 
 	if (terrain.background_type == 0) {
-		FileRequestAsync* request = AsyncHandler::RequestFile("Backdrop", terrain.background_name);
-		request->Bind(&Background::OnBackgroundGraphicReady, this);
-		request->Start();
+		bg_request = AsyncHandler::RequestFile("Backdrop", terrain.background_name);
+		bg_request_id = bg_request->Bind(&Background::OnBackgroundGraphicReady, this);
+		bg_request->Start();
 		return;
 	}
 
-	FileRequestAsync* request = AsyncHandler::RequestFile("Frame", terrain.background_a_name);
-	request->Bind(&Background::OnBackgroundGraphicReady, this);
-	request->Start();
+	bg_request = AsyncHandler::RequestFile("Frame", terrain.background_a_name);
+	bg_request_id = bg_request->Bind(&Background::OnBackgroundGraphicReady, this);
+	bg_request->Start();
 
 	bg_hscroll = terrain.background_a_scrollh ? terrain.background_a_scrollh_speed : 0;
 	bg_vscroll = terrain.background_a_scrollv ? terrain.background_a_scrollv_speed : 0;
 
 	if (terrain.background_b) {
-		FileRequestAsync* request = AsyncHandler::RequestFile("Frame", terrain.background_b_name);
-		request->Bind(&Background::OnForegroundFrameGraphicReady, this);
-		request->Start();
+		fg_request = AsyncHandler::RequestFile("Frame", terrain.background_b_name);
+		fg_request_id = fg_request->Bind(&Background::OnForegroundFrameGraphicReady, this);
+		fg_request->Start();
 
 		fg_hscroll = terrain.background_b_scrollh ? terrain.background_b_scrollh_speed : 0;
 		fg_vscroll = terrain.background_b_scrollv ? terrain.background_b_scrollv_speed : 0;
@@ -87,6 +89,13 @@ void Background::OnForegroundFrameGraphicReady(FileRequestResult* result) {
 
 Background::~Background() {
 	Graphics::RemoveDrawable(this);
+
+	if (bg_request) {
+		bg_request->Unbind(bg_request_id);
+	}
+	if (fg_request) {
+		fg_request->Unbind(fg_request_id);
+	}
 }
 
 int Background::GetZ() const {
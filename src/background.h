@@ -23,6 +23,7 @@
 #include "system.h"
 #include "drawable.h"
 
+class FileRequestAsync;
 struct FileRequestResult;
 
 class Background : public Drawable {
@@ -59,6 +60,11 @@ private:
 	int fg_vscroll;
 	int fg_x;
 	int fg_y;
+
+	FileRequestAsync* bg_request;
+	FileRequestAsync* fg_request;
+	int bg_request_id;
+	int fg_request_id;
 };
 
 #endif
@@ -0,0 +1,182 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include <vector>
+#include <algorithm>
+
+#include "band_pool.h"
+#include "system.h"
+#include "output.h"
+
+#ifdef USE_SDL
+#  include <SDL.h>
+#  include <SDL_thread.h>
+#endif
+
+namespace {
+	int thread_count = 1;
+
+	// Bands smaller than this are not worth a thread switch
+	const int min_band_rows = 16;
+
+#ifdef USE_SDL
+	struct Job {
+		BandPool::BandFunc func;
+		void* data;
+		int rows;
+		int bands;
+	};
+
+	std::vector<SDL_Thread*> workers;
+	SDL_mutex* mutex = NULL;
+	SDL_cond* job_ready = NULL;
+	SDL_cond* job_done = NULL;
+	Job job;
+	// Incremented for every job, workers compare it to find new work
+	unsigned generation = 0;
+	int pending = 0;
+	bool quit = false;
+
+	void RunBand(Job const& current, int band) {
+		int begin = current.rows * band / current.bands;
+		int end = current.rows * (band + 1) / current.bands;
+		if (begin < end)
+			current.func(current.data, begin, end);
+	}
+
+	int WorkerMain(void* arg) {
+		// Band 0 belongs to the main thread
+		int band = static_cast<int>(reinterpret_cast<intptr_t>(arg));
+		unsigned seen = 0;
+
+		SDL_LockMutex(mutex);
+		for (;;) {
+			while (!quit && generation == seen)
+				SDL_CondWait(job_ready, mutex);
+			if (quit)
+				break;
+
+			seen = generation;
+			Job const current = job;
+			SDL_UnlockMutex(mutex);
+
+			if (band < current.bands)
+				RunBand(current, band);
+
+			SDL_LockMutex(mutex);
+			if (--pending == 0)
+				SDL_CondSignal(job_done);
+		}
+		SDL_UnlockMutex(mutex);
+
+		return 0;
+	}
+
+	void StartWorkers() {
+		mutex = SDL_CreateMutex();
+		job_ready = SDL_CreateCond();
+		job_done = SDL_CreateCond();
+		quit = false;
+		// Workers start at zero, jobs of earlier workers must not count
+		generation = 0;
+
+		for (int i = 1; i < thread_count; i++) {
+			void* arg = reinterpret_cast<void*>(static_cast<intptr_t>(i));
+#if SDL_MAJOR_VERSION==1
+			SDL_Thread* thread = SDL_CreateThread(WorkerMain, arg);
+#else
+			SDL_Thread* thread = SDL_CreateThread(WorkerMain, "band worker", arg);
+#endif
+			if (thread == NULL) {
+				Output::Warning("Couldn't start band worker thread: %s", SDL_GetError());
+				break;
+			}
+			workers.push_back(thread);
+		}
+	}
+#endif
+}
+
+void BandPool::SetThreads(int threads) {
+	Quit();
+	thread_count = std::max(threads, 1);
+}
+
+int BandPool::GetThreads() {
+	return thread_count;
+}
+
+void BandPool::Run(int rows, BandFunc func, void* data) {
+#ifdef USE_SDL
+	int bands = std::min(thread_count, rows / min_band_rows);
+	if (bands > 1) {
+		if (!mutex)
+			StartWorkers();
+
+		bands = std::min(bands, static_cast<int>(workers.size()) + 1);
+	}
+
+	if (bands > 1) {
+		Job current;
+		current.func = func;
+		current.data = data;
+		current.rows = rows;
+		current.bands = bands;
+
+		SDL_LockMutex(mutex);
+		job = current;
+		pending = workers.size();
+		++generation;
+		SDL_CondBroadcast(job_ready);
+		SDL_UnlockMutex(mutex);
+
+		RunBand(current, 0);
+
+		SDL_LockMutex(mutex);
+		while (pending > 0)
+			SDL_CondWait(job_done, mutex);
+		SDL_UnlockMutex(mutex);
+		return;
+	}
+#endif
+
+	func(data, 0, rows);
+}
+
+void BandPool::Quit() {
+#ifdef USE_SDL
+	if (!mutex)
+		return;
+
+	SDL_LockMutex(mutex);
+	quit = true;
+	SDL_CondBroadcast(job_ready);
+	SDL_UnlockMutex(mutex);
+
+	for (std::vector<SDL_Thread*>::iterator it = workers.begin(); it != workers.end(); ++it)
+		SDL_WaitThread(*it, NULL);
+	workers.clear();
+
+	SDL_DestroyCond(job_done);
+	SDL_DestroyCond(job_ready);
+	SDL_DestroyMutex(mutex);
+	job_done = NULL;
+	job_ready = NULL;
+	mutex = NULL;
+#endif
+}
@@ -0,0 +1,65 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BAND_POOL_H_
+#define _BAND_POOL_H_
+
+/**
+ * BandPool namespace.
+ * Splits row based pixel work into horizontal bands and runs them on
+ * worker threads. Every band covers a fixed range of rows, so the
+ * result does not depend on the thread scheduling.
+ */
+namespace BandPool {
+	/**
+	 * Function processing the rows [begin, end).
+	 * Bands run concurrently and must only write to their own rows.
+	 */
+	typedef void (*BandFunc)(void* data, int begin, int end);
+
+	/**
+	 * Sets the number of threads used for band processing.
+	 * 0 or 1 (the default) disables band processing.
+	 *
+	 * @param threads number of threads including the main thread.
+	 */
+	void SetThreads(int threads);
+
+	/**
+	 * Gets the number of threads used for band processing.
+	 *
+	 * @return number of threads.
+	 */
+	int GetThreads();
+
+	/**
+	 * Processes rows [0, rows) and returns when all bands are done.
+	 * Small jobs run on the calling thread.
+	 *
+	 * @param rows number of rows.
+	 * @param func band function.
+	 * @param data argument of func.
+	 */
+	void Run(int rows, BandFunc func, void* data);
+
+	/**
+	 * Stops the worker threads.
+	 */
+	void Quit();
+}
+
+#endif
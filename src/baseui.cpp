@@ -22,6 +22,8 @@
 
 #ifdef USE_SDL
 #include "sdl_ui.h"
+#else
+#include "headless_ui.h"
 #endif
 
 EASYRPG_SHARED_PTR<BaseUi> DisplayUi;
@@ -30,7 +32,7 @@ EASYRPG_SHARED_PTR<BaseUi> BaseUi::CreateUi(long width, long height, const std::
 #ifdef USE_SDL
 	return EASYRPG_MAKE_SHARED<SdlUi>(width, height, title, fs_flag);
 #else
-#error cannot create UI
+	return EASYRPG_MAKE_SHARED<HeadlessUi>(width, height);
 #endif
 }
 
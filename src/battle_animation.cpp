@@ -15,6 +15,7 @@
  * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include "bitmap.h"
 #include "async_handler.h"
 #include "rpg_animation.h"
@@ -26,7 +27,7 @@
 #include "baseui.h"
 
 BattleAnimation::BattleAnimation(int x, int y, const RPG::Animation* animation) :
-	x(x), y(y), animation(animation), frame(0)
+	x(x), y(y), animation(animation), frame(0), request(NULL)
 {
 	const std::string& name = animation->animation_name;
 	BitmapRef graphic;
@@ -41,18 +42,18 @@ BattleAnimation::BattleAnimation(int x, int y, const RPG::Animation* animation)
 	// And we can't rely on "success" state of FileRequest because it's always
 	// true on desktop.
 #ifdef EMSCRIPTEN
-	FileRequestAsync* request = AsyncHandler::RequestFile("Battle", animation->animation_name);
-	request->Bind(&BattleAnimation::OnBattleSpriteReady, this);
+	request = AsyncHandler::RequestFile("Battle", animation->animation_name);
+	request_id = request->Bind(&BattleAnimation::OnBattleSpriteReady, this);
 	request->Start();
 #else
 	if (!FileFinder::FindImage("Battle", name).empty()) {
-		FileRequestAsync* request = AsyncHandler::RequestFile("Battle", animation->animation_name);
-		request->Bind(&BattleAnimation::OnBattleSpriteReady, this);
+		request = AsyncHandler::RequestFile("Battle", animation->animation_name);
+		request_id = request->Bind(&BattleAnimation::OnBattleSpriteReady, this);
 		request->Start();
 	}
 	else if (!FileFinder::FindImage("Battle2", name).empty()) {
-		FileRequestAsync* request = AsyncHandler::RequestFile("Battle2", animation->animation_name);
-		request->Bind(&BattleAnimation::OnBattle2SpriteReady, this);
+		request = AsyncHandler::RequestFile("Battle2", animation->animation_name);
+		request_id = request->Bind(&BattleAnimation::OnBattle2SpriteReady, this);
 		request->Start();
 	}
 	else {
@@ -65,6 +66,10 @@ BattleAnimation::BattleAnimation(int x, int y, const RPG::Animation* animation)
 
 BattleAnimation::~BattleAnimation() {
 	Graphics::RemoveDrawable(this);
+
+	if (request) {
+		request->Unbind(request_id);
+	}
 }
 
 int BattleAnimation::GetZ() const {
@@ -93,18 +98,76 @@ void BattleAnimation::Draw() {
 		int sy = cell.cell_id / 5;
 		int size = large ? 128 : 96;
 		Rect src_rect(sx * size, sy * size, size, size);
-		Tone tone(cell.tone_red, cell.tone_green, cell.tone_blue, cell.tone_gray);
+		Bitmap const* graphic = screen.get();
 		int opacity = 255 * (100 - cell.transparency) / 100;
 		double zoom = cell.zoom / 100.0;
+
+		if (Tone(cell.tone_red, cell.tone_green, cell.tone_blue, cell.tone_gray) != Tone()) {
+			tone_key key;
+			key[0] = cell.cell_id;
+			key[1] = cell.tone_red;
+			key[2] = cell.tone_green;
+			key[3] = cell.tone_blue;
+			key[4] = cell.tone_gray;
+
+			int index = tone_cells[key];
+			src_rect = Rect(index % 5 * size, index / 5 * size, size, size);
+			graphic = tone_atlas.get();
+		}
+
 		DisplayUi->GetDisplaySurface()->EffectsBlit(
 			x + cell.x, y + cell.y,
 			size / 2, size / 2,
-			*screen, src_rect, 
-			opacity, tone,
+			*graphic, src_rect,
+			opacity, Tone(),
 			zoom, zoom);
 	}
 }
 
+void BattleAnimation::CreateToneAtlas() {
+	tone_cells.clear();
+	tone_atlas.reset();
+
+	std::vector<RPG::AnimationFrame>::const_iterator frame_it;
+	std::vector<RPG::AnimationCellData>::const_iterator it;
+	for (frame_it = animation->frames.begin(); frame_it != animation->frames.end(); ++frame_it) {
+		for (it = frame_it->cells.begin(); it != frame_it->cells.end(); ++it) {
+			const RPG::AnimationCellData& cell = *it;
+			if (Tone(cell.tone_red, cell.tone_green, cell.tone_blue, cell.tone_gray) == Tone())
+				continue;
+
+			tone_key key;
+			key[0] = cell.cell_id;
+			key[1] = cell.tone_red;
+			key[2] = cell.tone_green;
+			key[3] = cell.tone_blue;
+			key[4] = cell.tone_gray;
+
+			if (tone_cells.find(key) == tone_cells.end()) {
+				int index = tone_cells.size();
+				tone_cells[key] = index;
+			}
+		}
+	}
+
+	if (tone_cells.empty())
+		return;
+
+	int size = large ? 128 : 96;
+	int count = tone_cells.size();
+	tone_atlas = Bitmap::Create(std::min(count, 5) * size, (count + 4) / 5 * size, true);
+	tone_atlas->Clear();
+
+	std::map<tone_key, int>::const_iterator cell_it;
+	for (cell_it = tone_cells.begin(); cell_it != tone_cells.end(); ++cell_it) {
+		const tone_key& key = cell_it->first;
+		int index = cell_it->second;
+		Rect src_rect(key[0] % 5 * size, key[0] / 5 * size, size, size);
+		tone_atlas->ToneBlit(index % 5 * size, index / 5 * size, *screen, src_rect,
+							 Tone(key[1], key[2], key[3], key[4]));
+	}
+}
+
 void BattleAnimation::Update() {
 	static bool update = true;
 	if (update) {
@@ -132,11 +195,12 @@ bool BattleAnimation::IsDone() const {
 void BattleAnimation::OnBattleSpriteReady(FileRequestResult* result) {
 	if (result->success) {
 		screen = Cache::Battle(result->file);
+		CreateToneAtlas();
 	}
 	else {
 		// Try battle2
-		FileRequestAsync* request = AsyncHandler::RequestFile("Battle2", result->file);
-		request->Bind(&BattleAnimation::OnBattle2SpriteReady, this);
+		request = AsyncHandler::RequestFile("Battle2", result->file);
+		request_id = request->Bind(&BattleAnimation::OnBattle2SpriteReady, this);
 		request->Start();
 	}
 }
@@ -144,6 +208,7 @@ void BattleAnimation::OnBattleSpriteReady(FileRequestResult* result) {
 void BattleAnimation::OnBattle2SpriteReady(FileRequestResult* result) {
 	if (result->success) {
 		screen = Cache::Battle2(result->file);
+		CreateToneAtlas();
 	}
 	else {
 		Output::Warning("Couldn't find animation: %s", result->file.c_str());
@@ -19,10 +19,12 @@
 #define _BATTLE_ANIMATION_H_
 
 // Headers
+#include <map>
 #include "system.h"
 #include "rpg_animation.h"
 #include "drawable.h"
 
+class FileRequestAsync;
 struct FileRequestResult;
 
 class BattleAnimation : public Drawable {
@@ -43,6 +45,7 @@ public:
 protected:
 	void OnBattleSpriteReady(FileRequestResult* result);
 	void OnBattle2SpriteReady(FileRequestResult* result);
+	void CreateToneAtlas();
 
 	int x;
 	int y;
@@ -50,6 +53,16 @@ protected:
 	int frame;
 	bool large;
 	BitmapRef screen;
+	FileRequestAsync* request;
+	int request_id;
+
+	// cell_id, red, green, blue, gray
+	typedef EASYRPG_ARRAY<int, 5> tone_key;
+
+	/** Position in tone_atlas of every toned cell used by the animation. */
+	std::map<tone_key, int> tone_cells;
+	/** Toned cells, laid out in rows of five like the animation graphic. */
+	BitmapRef tone_atlas;
 };
 
 #endif
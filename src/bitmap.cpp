@@ -24,8 +24,10 @@
 
 #include "system.h"
 #include "utils.h"
+#include "asset_pack.h"
 #include "cache.h"
 #include "bitmap.h"
+#include "band_pool.h"
 #include "text.h"
 #include "filefinder.h"
 #include "options.h"
@@ -34,11 +36,14 @@
 #include "image_xyz.h"
 #include "image_bmp.h"
 #include "image_png.h"
+#include "image_cache.h"
 #include "pixel_format.h"
 #include "font.h"
+#include "frame_arena.h"
 #include "output.h"
 #include "util_macro.h"
-#include "bitmap_hslrgb.h"
+#include "hslrgb.h"
+#include "bitmap_tone.h"
 
 const Opacity Opacity::opaque;
 
@@ -52,6 +57,10 @@ BitmapRef Bitmap::Create(const std::string& filename, bool transparent, uint32_t
 	return EASYRPG_MAKE_SHARED<Bitmap>(filename, transparent, flags);
 }
 
+BitmapRef Bitmap::Create(const std::string& filename, DecodedImage& image, bool transparent, uint32_t flags) {
+	return BitmapRef(new Bitmap(filename, image, transparent, flags));
+}
+
 BitmapRef Bitmap::Create(const uint8_t* data, unsigned bytes, bool transparent, uint32_t flags) {
 	return EASYRPG_MAKE_SHARED<Bitmap>(data, bytes, transparent, flags);
 }
@@ -60,7 +69,24 @@ BitmapRef Bitmap::Create(Bitmap const& source, Rect const& src_rect, bool transp
 	return EASYRPG_MAKE_SHARED<Bitmap>(source, src_rect, transparent);
 }
 
+BitmapRef Bitmap::CreateView(BitmapRef const& source, Rect const& src_rect) {
+	Rect rect = src_rect;
+	rect.Adjust(source->GetRect());
+
+	BitmapRef view(new Bitmap());
+	view->format = source->format;
+	view->pixman_format = source->pixman_format;
+	view->indexed = source->indexed;
+	// A view of a view shares the pixels of the owner directly
+	view->parent = source->parent ? source->parent : source;
+	view->Init(rect.width, rect.height, source->pointer(rect.x, rect.y), source->pitch(), false);
+	return view;
+}
+
 void Bitmap::InitBitmap() {
+	static unsigned next_id = 0;
+	id = ++next_id;
+	revision = 0;
 	editing = false;
 	font = Font::Default();
 }
@@ -100,6 +126,14 @@ Rect Bitmap::GetRect() const {
 	return Rect(0, 0, width(), height());
 }
 
+unsigned Bitmap::GetId() const {
+	return id;
+}
+
+unsigned Bitmap::GetRevision() const {
+	return revision;
+}
+
 bool Bitmap::GetTransparent() const {
 	return format.alpha_type != PF::NoAlpha;
 }
@@ -164,11 +198,11 @@ Bitmap::TileOpacity Bitmap::GetTileOpacity(int row, int col) {
 	return opacity? (*opacity)[row][col] : Partial;
 }
 
-Color Bitmap::GetBackgroundColor() {
+Color Bitmap::GetBackgroundColor() const {
 	return bg_color;
 }
 
-Color Bitmap::GetShadowColor() {
+Color Bitmap::GetShadowColor() const {
 	return sh_color;
 }
 
@@ -192,7 +226,14 @@ BitmapRef Bitmap::Create(void *pixels, int width, int height, int pitch, const D
 	return EASYRPG_MAKE_SHARED<Bitmap>(pixels, width, height, pitch, format);
 }
 
-void Bitmap::HueChangeBlit(int x, int y, Bitmap const& src, Rect const& src_rect_, double hue_) {
+BitmapRef Bitmap::CreateTransient(int width, int height, bool transparent) {
+	const DynamicFormat& format = transparent ? pixel_format : opaque_pixel_format;
+	int pitch = (width * format.bytes + 3) & ~3;
+	void* pixels = FrameArena::Allocate(pitch * height);
+	return Create(pixels, width, height, pitch, format);
+}
+
+void Bitmap::HueChangeBlit(int x, int y, Bitmap const& src, Rect const& src_rect_, double hue) {
 	Rect dst_rect(x, y, 0, 0), src_rect = src_rect_;
 
 	if (!Rect::AdjustRectangles(src_rect, dst_rect, src.GetRect()))
@@ -200,28 +241,17 @@ void Bitmap::HueChangeBlit(int x, int y, Bitmap const& src, Rect const& src_rect
 	if (!Rect::AdjustRectangles(dst_rect, src_rect, GetRect()))
 		return;
 
-	int hue  = (int) (hue_ / 60.0 * 0x100);
-	if (hue < 0)
-		hue += ((-hue + 0x5FF) / 0x600) * 0x600;
-	else if (hue > 0x600)
-		hue -= (hue / 0x600) * 0x600;
-
 	DynamicFormat format(32,8,24,8,16,8,8,8,0,PF::Alpha);
+	// Hue changes are cached and mostly done while loading, not per frame,
+	// so the frame arena would only keep their peak size around
 	std::vector<uint32_t> pixels;
 	pixels.resize(src_rect.width * src_rect.height);
 	Bitmap bmp(reinterpret_cast<void*>(&pixels.front()), src_rect.width, src_rect.height, src_rect.width * 4, format);
 	bmp.Blit(0, 0, src, src_rect, Opacity::opaque);
 
-	for (std::vector<uint32_t>::iterator p = pixels.begin(); p != pixels.end(); ++p) {
-		uint32_t pixel = *p;
-		uint8_t r = (pixel>>24) & 0xFF;
-		uint8_t g = (pixel>>16) & 0xFF;
-		uint8_t b = (pixel>> 8) & 0xFF;
-		uint8_t a = pixel & 0xFF;
-		if (a > 0)
-			RGB_adjust_HSL(r, g, b, hue);
-		*p = ((uint32_t) r << 24) | ((uint32_t) g << 16) | ((uint32_t) b << 8) | (uint32_t) a;
-	}
+	HueRotation rotation(hue);
+	for (int row = 0; row < src_rect.height; row++)
+		rotation.Row(&pixels[row * src_rect.width], src_rect.width);
 
 	Blit(dst_rect.x, dst_rect.y, bmp, bmp.GetRect(), Opacity::opaque);
 
@@ -229,6 +259,7 @@ void Bitmap::HueChangeBlit(int x, int y, Bitmap const& src, Rect const& src_rect
 }
 
 void Bitmap::RefreshCallback() {
+	++revision;
 }
 
 FontRef const& Bitmap::GetFont() const {
@@ -435,6 +466,10 @@ static void destroy_func(pixman_image_t * /* image */, void *data) {
 	free(data);
 }
 
+static void release_cached(pixman_image_t * /* image */, void *data) {
+	ImageCache::Release(data);
+}
+
 static pixman_indexed_t palette;
 static bool palette_initialized = false;
 
@@ -458,7 +493,9 @@ void Bitmap::Init(int width, int height, void* data, int pitch, bool destroy) {
 		Output::Error("Couldn't create %dx%d image.", width, height);
 	}
 
-	if (format.bits == 8) {
+	if (indexed) {
+		pixman_image_set_indexed(bitmap, indexed.get());
+	} else if (format.bits == 8) {
 		initialize_palette();
 		pixman_image_set_indexed(bitmap, &palette);
 	}
@@ -467,7 +504,113 @@ void Bitmap::Init(int width, int height, void* data, int pitch, bool destroy) {
 		pixman_image_set_destroy_function(bitmap, destroy_func, data);
 }
 
+static bool indexed_images = INDEXED_IMAGES;
+
+void Bitmap::SetIndexedImages(bool enabled) {
+	indexed_images = enabled;
+}
+
+void Bitmap::InitIndexed(int width, int height, void* data, const uint32_t* palette, bool transparent) {
+	format = DynamicFormat(8,8,0,8,0,8,0,8,0, transparent ? PF::Alpha : PF::NoAlpha);
+	pixman_format = PIXMAN_c8;
+
+	// ent is only used when drawing onto the image, which is not supported
+	indexed.reset(new pixman_indexed_t);
+	memset(indexed.get(), 0, sizeof(pixman_indexed_t));
+	indexed->color = true;
+	for (int i = 0; i < 256; i++) {
+		const uint8_t* rgba = (const uint8_t*) &palette[i];
+		uint8_t r = rgba[0], g = rgba[1], b = rgba[2], a = rgba[3];
+		MultiplyAlpha(r, g, b, a);
+		indexed->rgba[i] = ((uint32_t) a << 24) | ((uint32_t) r << 16) | ((uint32_t) g << 8) | b;
+	}
+
+	Init(width, height, data, (width + 3) & ~3);
+}
+
+bool Bitmap::IsIndexed() const {
+	return indexed.get() != NULL;
+}
+
+const uint32_t* Bitmap::GetPalette() const {
+	return indexed ? indexed->rgba : NULL;
+}
+
+BitmapRef Bitmap::CreateIndexed(Bitmap const& source, Rect const& src_rect,
+								bool flip_x, bool flip_y, const uint32_t* palette) {
+	assert(source.IsIndexed());
+
+	int const pitch = (src_rect.width + 3) & ~3;
+	uint8_t* pixels = (uint8_t*) malloc(pitch * src_rect.height);
+	for (int y = 0; y < src_rect.height; y++) {
+		int const src_y = src_rect.y + (flip_y ? src_rect.height - 1 - y : y);
+		uint8_t const* src = source.pointer(src_rect.x, src_y);
+		uint8_t* dst = pixels + y * pitch;
+		if (flip_x) {
+			for (int x = 0; x < src_rect.width; x++)
+				dst[x] = src[src_rect.width - 1 - x];
+		} else {
+			memcpy(dst, src, src_rect.width);
+		}
+	}
+
+	BitmapRef bitmap(new Bitmap());
+	bitmap->format = source.format;
+	bitmap->pixman_format = PIXMAN_c8;
+	bitmap->indexed.reset(new pixman_indexed_t);
+	memset(bitmap->indexed.get(), 0, sizeof(pixman_indexed_t));
+	bitmap->indexed->color = true;
+	memcpy(bitmap->indexed->rgba, palette, 256 * sizeof(uint32_t));
+	bitmap->Init(src_rect.width, src_rect.height, pixels, pitch);
+	return bitmap;
+}
+
+namespace {
+	/** 32 bit formats with 8 bit channels are accessed directly by image loading and some blits. */
+	bool IsDirectFormat(const DynamicFormat& format) {
+		return format.bits == 32 &&
+			format.r.bits == 8 && format.g.bits == 8 && format.b.bits == 8 &&
+			(format.a.bits == 8 || format.alpha_type == PF::NoAlpha);
+	}
+
+	/** r * a / 255, rounded down like MultiplyAlpha, for two 8 bit lanes at once. */
+	inline uint32_t PremultiplyLanes(uint32_t lanes, uint32_t a) {
+		lanes *= a;
+		return ((lanes + ((lanes >> 8) & 0x00FF00FF) + 0x00010001) >> 8) & 0x00FF00FF;
+	}
+
+	/**
+	 * Premultiplies decoded r8g8b8a8 pixels and stores them in the
+	 * 32 bit format with 8 bit channels in place.
+	 */
+	void PremultiplyInPlace(const DynamicFormat& format, bool transparent, uint8_t* pixels, size_t count) {
+		const bool alpha = format.a.bits == 8;
+		uint32_t* dst = (uint32_t*) pixels;
+
+		for (size_t i = 0; i < count; i++, pixels += 4) {
+			uint32_t a = pixels[3];
+			uint32_t rb = PremultiplyLanes(pixels[0] | ((uint32_t) pixels[2] << 16), a);
+			uint32_t g = PremultiplyLanes(pixels[1], a);
+
+			uint32_t p = ((rb & 0xFF) << format.r.shift) |
+				(g << format.g.shift) |
+				((rb >> 16) << format.b.shift);
+			if (alpha)
+				p |= (transparent ? a : 0xFF) << format.a.shift;
+			dst[i] = p;
+		}
+	}
+}
+
 void Bitmap::ConvertImage(int& width, int& height, void*& pixels, bool transparent) {
+	// 32 bit formats with 8 bit channels take over the decoded buffer,
+	// so loading allocates once and converts every pixel in one pass
+	if (IsDirectFormat(format)) {
+		PremultiplyInPlace(format, transparent, (uint8_t*) pixels, (size_t) width * height);
+		Init(width, height, pixels);
+		return;
+	}
+
 	const DynamicFormat& img_format = transparent ? image_format : opaque_image_format;
 
 	// premultiply alpha
@@ -482,6 +625,8 @@ void Bitmap::ConvertImage(int& width, int& height, void*& pixels, bool transpare
 		}
 	}
 
+	Init(width, height, (void *) NULL);
+
 	Bitmap src(pixels, width, height, 0, img_format);
 	Clear();
 	Blit(0, 0, src, src.GetRect(), Opacity::opaque);
@@ -510,33 +655,92 @@ Bitmap::Bitmap(const std::string& filename, bool transparent, uint32_t flags) {
 	format = (transparent ? pixel_format : opaque_pixel_format);
 	pixman_format = find_format(format);
 
-	FILE* stream = FileFinder::fopenUTF8(filename, "rb");
-	if (!stream) {
-		Output::Error("Couldn't open image file %s", filename.c_str());
+	// Indexed images are decoded, the cache holds expanded pixels
+	bool want_palette = indexed_images && (flags & Indexed);
+
+	ImageCache::Pixels cached;
+	if (!want_palette && ImageCache::Find(filename, format, cached)) {
+		Init(cached.width, cached.height, cached.data, cached.pitch, false);
+		pixman_image_set_destroy_function(bitmap, release_cached, cached.handle);
+
+		CheckPixels(flags);
 		return;
 	}
 
-	int w = 0;
-	int h = 0;
-	void* pixels;
+	DecodedImage image;
+	if (!Decode(filename, transparent, flags, image)) {
+		Output::Error("Couldn't read image file %s", filename.c_str());
+		return;
+	}
+
+	InitDecoded(filename, image, transparent, flags);
+}
+
+Bitmap::Bitmap(const std::string& filename, DecodedImage& image, bool transparent, uint32_t flags) {
+	InitBitmap();
+
+	format = (transparent ? pixel_format : opaque_pixel_format);
+	pixman_format = find_format(format);
+
+	InitDecoded(filename, image, transparent, flags);
+}
+
+bool Bitmap::Decode(const std::string& filename, bool transparent, uint32_t flags, DecodedImage& image) {
+	image.width = 0;
+	image.height = 0;
+	image.pixels = NULL;
+	image.indexed = false;
+
+	uint32_t* want_palette = indexed_images && (flags & Indexed) ? image.palette : NULL;
+
+	// Packed images are decoded from the pack data in place
+	const uint8_t* packed;
+	size_t packed_size;
+	if (AssetPack::Find(filename, packed, packed_size)) {
+		if (packed_size > 4 && strncmp((char*) packed, "XYZ1", 4) == 0)
+			image.indexed = ImageXYZ::ReadXYZ(packed, packed_size, transparent, image.width, image.height, image.pixels, want_palette);
+		else if (packed_size > 2 && strncmp((char*) packed, "BM", 2) == 0)
+			ImageBMP::ReadBMP(packed, packed_size, transparent, image.width, image.height, image.pixels);
+		else if (packed_size > 4 && strncmp((char*)(packed + 1), "PNG", 3) == 0)
+			image.indexed = ImagePNG::ReadPNG((FILE*) NULL, (const void*) packed, packed_size, transparent, image.width, image.height, image.pixels, want_palette);
+		else
+			return false;
+
+		return image.pixels != NULL;
+	}
+
+	FILE* stream = FileFinder::fopenUTF8(filename, "rb");
+	if (!stream)
+		return false;
 
 	char data[4];
 	size_t bytes = fread(&data, 1, 4, stream);
 	fseek(stream, 0, SEEK_SET);
 
+	bool supported = true;
 	if (bytes >= 4 && strncmp((char*)data, "XYZ1", 4) == 0)
-		ImageXYZ::ReadXYZ(stream, transparent, w, h, pixels);
+		image.indexed = ImageXYZ::ReadXYZ(stream, transparent, image.width, image.height, image.pixels, want_palette);
 	else if (bytes > 2 && strncmp((char*)data, "BM", 2) == 0)
-		ImageBMP::ReadBMP(stream, transparent, w, h, pixels);
+		ImageBMP::ReadBMP(stream, transparent, image.width, image.height, image.pixels);
 	else if (bytes >= 4 && strncmp((char*)(data + 1), "PNG", 3) == 0)
-		ImagePNG::ReadPNG(stream, (void*)NULL, transparent, w, h, pixels);
+		image.indexed = ImagePNG::ReadPNG(stream, (void*)NULL, 0, transparent, image.width, image.height, image.pixels, want_palette);
 	else
-		Output::Error("Unsupported image file %s", filename.c_str());
+		supported = false;
 
 	fclose(stream);
 
-	Init(w, h, (void *) NULL);
-	ConvertImage(w, h, pixels, transparent);
+	return supported && image.pixels != NULL;
+}
+
+void Bitmap::InitDecoded(const std::string& filename, DecodedImage& image, bool transparent, uint32_t flags) {
+	if (image.indexed) {
+		InitIndexed(image.width, image.height, image.pixels, image.palette, transparent);
+	} else {
+		ConvertImage(image.width, image.height, image.pixels, transparent);
+
+		ImageCache::Store(filename, format, image.width, image.height, pitch(), pixels());
+	}
+	image.pixels = NULL;
 
 	CheckPixels(flags);
 }
@@ -547,19 +751,25 @@ Bitmap::Bitmap(const uint8_t* data, unsigned bytes, bool transparent, uint32_t f
 	format = (transparent ? pixel_format : opaque_pixel_format);
 	pixman_format = find_format(format);
 
-	int w, h;
-	void* pixels;
+	int w = 0, h = 0;
+	void* pixels = NULL;
 
 	if (bytes > 4 && strncmp((char*) data, "XYZ1", 4) == 0)
 		ImageXYZ::ReadXYZ(data, bytes, transparent, w, h, pixels);
 	else if (bytes > 2 && strncmp((char*) data, "BM", 2) == 0)
 		ImageBMP::ReadBMP(data, bytes, transparent, w, h, pixels);
 	else if (bytes > 4 && strncmp((char*)(data + 1), "PNG", 3) == 0)
-		ImagePNG::ReadPNG((FILE*) NULL, (const void*) data, transparent, w, h, pixels);
-	else
+		ImagePNG::ReadPNG((FILE*) NULL, (const void*) data, bytes, transparent, w, h, pixels);
+	else {
 		Output::Error("Unsupported image");
+		return;
+	}
+
+	if (pixels == NULL) {
+		Output::Error("Couldn't read image");
+		return;
+	}
 
-	Init(w, h, (void *) NULL);
 	ConvertImage(w, h, pixels, transparent);
 
 	CheckPixels(flags);
@@ -616,19 +826,55 @@ uint32_t Bitmap::amask() const {
 }
 
 namespace {
-	pixman_image_t *CreateMask(Opacity const& opacity, Rect const& src_rect, pixman_transform_t const* pxform = NULL) {
-		if (opacity.IsOpaque())
-			return (pixman_image_t*) NULL;
+	// Opacity masks are reused between blits, the pool keeps one reference
+	pixman_image_t* solid_masks[256];
+	typedef std::map<std::pair<int, int>, pixman_image_t*> split_mask_map;
+	split_mask_map split_masks;
+	// Bounds the pool for effects that fade the bush opacity
+	const size_t max_split_masks = 256;
+	Bitmap::MaskStats mask_stats;
+
+	pixman_image_t* SolidMask(int opacity) {
+		pixman_image_t*& mask = solid_masks[opacity & 0xFF];
+		if (mask == NULL) {
+			pixman_color_t tcolor = {0, 0, 0, static_cast<uint16_t>(opacity << 8)};
+			mask = pixman_image_create_solid_fill(&tcolor);
+			++mask_stats.allocations;
+		} else {
+			++mask_stats.hits;
+		}
+		return pixman_image_ref(mask);
+	}
 
-		if (!opacity.IsSplit()) {
-			pixman_color_t tcolor = {0, 0, 0, static_cast<uint16_t>(opacity.Value() << 8)};
-			return pixman_image_create_solid_fill(&tcolor);
+	pixman_image_t* SplitMask(int top, int bottom) {
+		std::pair<int, int> const key(top & 0xFF, bottom & 0xFF);
+		split_mask_map::const_iterator const it = split_masks.find(key);
+		if (it != split_masks.end()) {
+			++mask_stats.hits;
+			return pixman_image_ref(it->second);
 		}
 
+		if (split_masks.size() >= max_split_masks)
+			Bitmap::ClearMaskPool();
+
 		pixman_image_t *mask = pixman_image_create_bits(PIXMAN_a8, 1, 2, (uint32_t*) NULL, 4);
 		uint32_t* pixels = pixman_image_get_data(mask);
-		*reinterpret_cast<uint8_t*>(&pixels[0]) = (opacity.top & 0xFF);
-		*reinterpret_cast<uint8_t*>(&pixels[1]) = (opacity.bottom & 0xFF);
+		*reinterpret_cast<uint8_t*>(&pixels[0]) = key.first;
+		*reinterpret_cast<uint8_t*>(&pixels[1]) = key.second;
+		split_masks[key] = mask;
+		++mask_stats.allocations;
+
+		return pixman_image_ref(mask);
+	}
+
+	pixman_image_t *CreateMask(Opacity const& opacity, Rect const& src_rect, pixman_transform_t const* pxform = NULL) {
+		if (opacity.IsOpaque())
+			return (pixman_image_t*) NULL;
+
+		if (!opacity.IsSplit())
+			return SolidMask(opacity.Value());
+
+		pixman_image_t *mask = SplitMask(opacity.top, opacity.bottom);
 
 		pixman_transform_t xform;
 		pixman_transform_init_identity(&xform);
@@ -643,12 +889,172 @@ namespace {
 		if (pxform)
 			pixman_transform_multiply(&xform, &xform, pxform);
 
+		// Pooled masks are shared, so the transform is set on every use
 		pixman_image_set_transform(mask, &xform);
 
 		return mask;
 	}
+
+	/** Converts a pixel of a direct format to a8r8g8b8. */
+	inline uint32_t ReadDirect(const DynamicFormat& format, uint32_t pixel) {
+		uint32_t a = format.alpha_type != PF::NoAlpha ? (pixel >> format.a.shift) & 0xFF : 0xFF;
+		return (a << 24) |
+			(((pixel >> format.r.shift) & 0xFF) << 16) |
+			(((pixel >> format.g.shift) & 0xFF) << 8) |
+			((pixel >> format.b.shift) & 0xFF);
+	}
+
+	/** Converts an a8r8g8b8 pixel to a direct format. */
+	inline uint32_t WriteDirect(const DynamicFormat& format, uint32_t p) {
+		return (((p >> 16) & 0xFF) << format.r.shift) |
+			(((p >> 8) & 0xFF) << format.g.shift) |
+			((p & 0xFF) << format.b.shift) |
+			(format.alpha_type != PF::NoAlpha ? (p >> 24) << format.a.shift : 0);
+	}
+
+	/** Multiplies all channels of an a8r8g8b8 pixel by m / 255 (pixman rounding). */
+	inline uint32_t MulDirect(uint32_t p, uint32_t m) {
+		uint32_t rb = (p & 0xFF00FF) * m + 0x800080;
+		uint32_t ag = ((p >> 8) & 0xFF00FF) * m + 0x800080;
+		rb = ((rb + ((rb >> 8) & 0xFF00FF)) >> 8) & 0xFF00FF;
+		ag = (ag + ((ag >> 8) & 0xFF00FF)) & 0xFF00FF00;
+		return rb | ag;
+	}
+
+	/** PIXMAN_OP_OVER of two premultiplied a8r8g8b8 pixels. */
+	inline uint32_t OverDirect(uint32_t s, uint32_t d) {
+		uint32_t sa = s >> 24;
+		if (sa == 0xFF)
+			return s;
+		uint32_t t = MulDirect(d, 0xFF - sa);
+		uint32_t rb = (t & 0xFF00FF) + (s & 0xFF00FF);
+		uint32_t ag = ((t >> 8) & 0xFF00FF) + ((s >> 8) & 0xFF00FF);
+		// Saturate each channel at 255
+		rb |= 0x1000100 - ((rb >> 8) & 0xFF00FF);
+		ag |= 0x1000100 - ((ag >> 8) & 0xFF00FF);
+		return (rb & 0xFF00FF) | ((ag & 0xFF00FF) << 8);
+	}
+
+	struct ToneJob {
+		uint8_t const* src;
+		int src_pitch;
+		DynamicFormat src_format;
+		uint8_t* dst;
+		int dst_pitch;
+		DynamicFormat dst_format;
+		int width;
+		Tone tone;
+	};
+
+	void ToneRows(void* data, int begin, int end) {
+		ToneJob const& job = *static_cast<ToneJob const*>(data);
+		const DynamicFormat& sf = job.src_format;
+		const DynamicFormat& df = job.dst_format;
+		bool dst_alpha = df.alpha_type != PF::NoAlpha;
+
+		// Every band has its own kernel, the memo is not shared
+		ToneKernel kernel(job.tone);
+
+		for (int j = begin; j < end; j++) {
+			const uint32_t* s = reinterpret_cast<const uint32_t*>(job.src + j * job.src_pitch);
+			uint32_t* d = reinterpret_cast<uint32_t*>(job.dst + j * job.dst_pitch);
+
+			for (int i = 0; i < job.width; i++) {
+				uint32_t p = ReadDirect(sf, s[i]);
+				uint32_t m = p >> 24;
+				if (!dst_alpha)
+					p |= 0xFF000000;
+
+				d[i] = WriteDirect(df, kernel.Apply(p, m));
+			}
+		}
+	}
+
+	/**
+	 * Source pixel the nearest filter of pixman samples for destination
+	 * pixel i of a scale transform, to match composites bit for bit.
+	 */
+	inline int NearestSource(pixman_fixed_t scale, int i) {
+		pixman_fixed_48_16_t v = ((pixman_fixed_48_16_t) scale * (pixman_int_to_fixed(i) + pixman_fixed_1 / 2) + 0x8000) >> 16;
+		return (int) ((v - pixman_fixed_e) >> 16);
+	}
+
+	struct WaverJob {
+		uint8_t const* src;
+		int src_pitch;
+		DynamicFormat src_format;
+		int src_height;
+		uint8_t* dst;
+		int dst_pitch;
+		DynamicFormat dst_format;
+		int dst_width;
+		int x;
+		int y;
+		int first;
+		int width;
+		pixman_fixed_t scale_y;
+		int const* columns;
+		int const* offsets;
+		Opacity opacity;
+	};
+
+	void WaverRows(void* data, int begin, int end) {
+		WaverJob const& job = *static_cast<WaverJob const*>(data);
+		const DynamicFormat& sf = job.src_format;
+		const DynamicFormat& df = job.dst_format;
+		Opacity const& opacity = job.opacity;
+
+		for (int i = job.first + begin; i < job.first + end; i++) {
+			int dy = job.y + i;
+
+			int sy = std::min(NearestSource(job.scale_y, i), job.src_height - 1);
+			int row_opacity = (opacity.IsSplit() && sy >= job.src_height - opacity.split)
+				? opacity.bottom : opacity.top;
+			if (row_opacity <= 0)
+				continue;
+			uint32_t m = std::min(row_opacity, 255);
+
+			int dx = job.x + job.offsets[sy];
+			int j0 = std::max(0, -dx);
+			int j1 = std::min(job.width, job.dst_width - dx);
+
+			const uint32_t* s = reinterpret_cast<const uint32_t*>(job.src + sy * job.src_pitch);
+			uint32_t* d = reinterpret_cast<uint32_t*>(job.dst + dy * job.dst_pitch);
+
+			for (int j = j0; j < j1; j++) {
+				uint32_t p = ReadDirect(sf, s[job.columns[j]]);
+				if (m != 0xFF)
+					p = MulDirect(p, m);
+				if ((p >> 24) == 0)
+					continue;
+				d[dx + j] = WriteDirect(df, OverDirect(p, ReadDirect(df, d[dx + j])));
+			}
+		}
+	}
 } // anonymous namespace
 
+Bitmap::MaskStats Bitmap::GetMaskStats() {
+	MaskStats stats = mask_stats;
+	stats.entries = split_masks.size();
+	for (int i = 0; i < 256; i++)
+		if (solid_masks[i] != NULL)
+			++stats.entries;
+	return stats;
+}
+
+void Bitmap::ClearMaskPool() {
+	for (int i = 0; i < 256; i++) {
+		if (solid_masks[i] != NULL) {
+			pixman_image_unref(solid_masks[i]);
+			solid_masks[i] = NULL;
+		}
+	}
+
+	for (split_mask_map::const_iterator i = split_masks.begin(); i != split_masks.end(); ++i)
+		pixman_image_unref(i->second);
+	split_masks.clear();
+}
+
 void Bitmap::Blit(int x, int y, Bitmap const& src, Rect const& src_rect, Opacity const& opacity) {
 	if (opacity.IsTransparent())
 		return;
@@ -671,8 +1077,11 @@ void Bitmap::Blit(int x, int y, Bitmap const& src, Rect const& src_rect, Opacity
 
 pixman_image_t* Bitmap::GetSubimage(Bitmap const& src, const Rect& src_rect) {
 	uint8_t* pixels = (uint8_t*) src.pixels() + src_rect.x * src.bpp() + src_rect.y * src.pitch();
-	return pixman_image_create_bits(src.pixman_format, src_rect.width, src_rect.height,
-									(uint32_t*) pixels, src.pitch());
+	pixman_image_t* image = pixman_image_create_bits(src.pixman_format, src_rect.width, src_rect.height,
+													 (uint32_t*) pixels, src.pitch());
+	if (src.indexed)
+		pixman_image_set_indexed(image, src.indexed.get());
+	return image;
 }
 
 void Bitmap::TiledBlit(Rect const& src_rect, Bitmap const& src, Rect const& dst_rect, Opacity const& opacity) {
@@ -781,21 +1190,30 @@ void Bitmap::TransformBlit(Rect const& dst_rect, Bitmap const& src, Rect const&
 
 	if (mask != NULL)
 		pixman_image_unref(mask);
+
+	RefreshCallback();
 }
 
-void Bitmap::WaverBlit(int x, int y, double zoom_x, double zoom_y, Bitmap const& src, Rect const& src_rect, int depth, double phase, Opacity const& opacity) {
+void Bitmap::WaverBlit(int x, int y, double zoom_x, double zoom_y, Bitmap const& src, Rect const& src_rect, int depth, double phase, int phase_row, Opacity const& opacity) {
 	if (opacity.IsTransparent())
 		return;
 
-	pixman_transform_t xform;
-	pixman_transform_init_scale(&xform,
-								pixman_double_to_fixed(1.0 / zoom_x),
-								pixman_double_to_fixed(1.0 / zoom_y));
+	if (WaverBlitFast(x, y, zoom_x, zoom_y, src, src_rect, depth, phase, phase_row, opacity))
+		return;
 
-	pixman_image_set_transform(src.bitmap, &xform);
+	pixman_fixed_t const scale_y = pixman_double_to_fixed(1.0 / zoom_y);
+	pixman_transform_t xform;
+	pixman_transform_init_scale(&xform, pixman_double_to_fixed(1.0 / zoom_x), scale_y);
 
+	// The mask is relative to src_rect, the source starts at it
 	pixman_image_t* mask = CreateMask(opacity, src_rect, &xform);
 
+	pixman_transform_translate(&xform, (pixman_transform_t*) NULL,
+							   pixman_int_to_fixed(src_rect.x),
+							   pixman_int_to_fixed(src_rect.y));
+
+	pixman_image_set_transform(src.bitmap, &xform);
+
 	int height = static_cast<int>(std::floor(src_rect.height * zoom_y));
 	int width  = static_cast<int>(std::floor(src_rect.width * zoom_x));
 	for (int i = 0; i < height; i++) {
@@ -804,13 +1222,13 @@ void Bitmap::WaverBlit(int x, int y, double zoom_x, double zoom_y, Bitmap const&
 			continue;
 		if (dy >= this->height())
 			break;
-		int sy = static_cast<int>(std::floor((i+0.5) / zoom_y));
-		int offset = (int) (2 * zoom_x * depth * sin((phase + (src_rect.y + sy) * 11.2) * 3.14159 / 180));
+		int sy = NearestSource(scale_y, i);
+		int offset = (int) (2 * zoom_x * depth * sin((phase + (phase_row + sy) * 11.2) * 3.14159 / 180));
 
 		pixman_image_composite32(PIXMAN_OP_OVER,
 								 src.bitmap, mask, bitmap,
-								 src_rect.x, i,
-								 src_rect.x, i,
+								 0, i,
+								 0, i,
 								 x + offset, dy,
 								 width, 1);
 	}
@@ -824,6 +1242,60 @@ void Bitmap::WaverBlit(int x, int y, double zoom_x, double zoom_y, Bitmap const&
 	RefreshCallback();
 }
 
+bool Bitmap::WaverBlitFast(int x, int y, double zoom_x, double zoom_y, Bitmap const& src, Rect const& src_rect, int depth, double phase, int phase_row, Opacity const& opacity) {
+	if (!IsDirectFormat(format) || !IsDirectFormat(src.format) || &src == this)
+		return false;
+
+	if (src_rect.x < 0 || src_rect.y < 0 ||
+		src_rect.x + src_rect.width > src.width() ||
+		src_rect.y + src_rect.height > src.height())
+		return false;
+
+	int height = static_cast<int>(std::floor(src_rect.height * zoom_y));
+	int width  = static_cast<int>(std::floor(src_rect.width * zoom_x));
+	if (width <= 0 || height <= 0)
+		return true;
+
+	// Source column of every destination column, sampled like pixman does
+	pixman_fixed_t const scale_x = pixman_double_to_fixed(1.0 / zoom_x);
+	int* columns = static_cast<int*>(FrameArena::Allocate(width * sizeof(int)));
+	for (int j = 0; j < width; j++)
+		columns[j] = std::min(NearestSource(scale_x, j), src_rect.width - 1);
+
+	// Wave offset of every source row for this phase
+	int* offsets = static_cast<int*>(FrameArena::Allocate(src_rect.height * sizeof(int)));
+	for (int r = 0; r < src_rect.height; r++)
+		offsets[r] = (int) (2 * zoom_x * depth * sin((phase + (phase_row + r) * 11.2) * 3.14159 / 180));
+
+	WaverJob job;
+	job.src = src.pointer(src_rect.x, src_rect.y);
+	job.src_pitch = src.pitch();
+	job.src_format = src.format;
+	job.src_height = src_rect.height;
+	job.dst = pointer(0, 0);
+	job.dst_pitch = pitch();
+	job.dst_format = format;
+	job.dst_width = this->width();
+	job.x = x;
+	job.y = y;
+	job.width = width;
+	job.scale_y = pixman_double_to_fixed(1.0 / zoom_y);
+	job.columns = columns;
+	job.offsets = offsets;
+	job.opacity = opacity;
+
+	// Only the rows inside the destination
+	int first = std::max(0, -y);
+	int last = std::min(height, this->height() - y);
+	job.first = first;
+	if (first < last)
+		BandPool::Run(last - first, &WaverRows, &job);
+
+	RefreshCallback();
+
+	return true;
+}
+
 static pixman_color_t PixmanColor(const Color &color) {
 	pixman_color_t pcolor;
 	pcolor.red = color.red * color.alpha;
@@ -887,6 +1359,9 @@ void Bitmap::ToneBlit(int x, int y, Bitmap const& src, Rect const& src_rect, con
 		return;
 	}
 
+	if (ToneBlitFast(x, y, src, src_rect, tone))
+		return;
+
 	if (&src != this)
 		pixman_image_composite32(PIXMAN_OP_SRC,
 								 src.bitmap, (pixman_image_t*) NULL, bitmap,
@@ -895,6 +1370,7 @@ void Bitmap::ToneBlit(int x, int y, Bitmap const& src, Rect const& src_rect, con
 								 x, y,
 								 src_rect.width, src_rect.height);
 
+	// The source alpha of each pixel masks the tone, like in BlendBlit
 	// FIXME: Saturation looks incorrect (compared to RPG_RT) for values > 128
 	if (tone.gray != 128) {
 		pixman_color_t gcolor = {
@@ -907,8 +1383,8 @@ void Bitmap::ToneBlit(int x, int y, Bitmap const& src, Rect const& src_rect, con
 
 		pixman_image_composite32(PIXMAN_OP_HSL_SATURATION,
 			gimage, src.bitmap, bitmap,
-			src_rect.x, src_rect.y,
 			0, 0,
+			src_rect.x, src_rect.y,
 			x, y,
 			src_rect.width, src_rect.height);
 
@@ -925,8 +1401,8 @@ void Bitmap::ToneBlit(int x, int y, Bitmap const& src, Rect const& src_rect, con
 
 		pixman_image_composite32(PIXMAN_OP_HARD_LIGHT,
 			timage, src.bitmap, bitmap,
-			src_rect.x, src_rect.y,
 			0, 0,
+			src_rect.x, src_rect.y,
 			x, y,
 			src_rect.width, src_rect.height);
 
@@ -936,6 +1412,38 @@ void Bitmap::ToneBlit(int x, int y, Bitmap const& src, Rect const& src_rect, con
 	RefreshCallback();
 }
 
+bool Bitmap::ToneBlitFast(int x, int y, Bitmap const& src, Rect const& src_rect_, const Tone &tone) {
+	if (!IsDirectFormat(format) || !IsDirectFormat(src.format))
+		return false;
+
+	// In place blits are only supported on the same area
+	if (&src == this && (x != src_rect_.x || y != src_rect_.y))
+		return false;
+
+	Rect dst_rect(x, y, 0, 0), src_rect = src_rect_;
+
+	if (!Rect::AdjustRectangles(src_rect, dst_rect, src.GetRect()))
+		return true;
+	if (!Rect::AdjustRectangles(dst_rect, src_rect, GetRect()))
+		return true;
+
+	ToneJob job;
+	job.src = src.pointer(src_rect.x, src_rect.y);
+	job.src_pitch = src.pitch();
+	job.src_format = src.format;
+	job.dst = pointer(dst_rect.x, dst_rect.y);
+	job.dst_pitch = pitch();
+	job.dst_format = format;
+	job.width = src_rect.width;
+	job.tone = tone;
+
+	BandPool::Run(src_rect.height, &ToneRows, &job);
+
+	RefreshCallback();
+
+	return true;
+}
+
 void Bitmap::BlendBlit(int x, int y, Bitmap const& src, Rect const& src_rect, const Color& color) {
 	if (color.alpha == 0) {
 		if (&src != this)
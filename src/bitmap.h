@@ -97,6 +97,42 @@ public:
 	 */
 	static BitmapRef Create(const std::string& filename, bool transparent = true, uint32_t flags = 0);
 
+	/**
+	 * Image file decoded into memory, see Decode.
+	 */
+	struct DecodedImage {
+		int width;
+		int height;
+		/** malloc'd r8g8b8a8 pixels, or palette indices when indexed. */
+		void* pixels;
+		bool indexed;
+		uint32_t palette[256];
+	};
+
+	/**
+	 * Reads and decodes an image file without creating a bitmap.
+	 * Only the file and the decoders are touched, so this may run on a
+	 * worker thread. Decoding errors are not reported, the caller does.
+	 *
+	 * @param filename image file to load.
+	 * @param transparent allow transparency on bitmap.
+	 * @param flags bitmap flags.
+	 * @param image receives the decoded image.
+	 * @return false if the file can't be opened, has an unknown format or
+	 *         is corrupt.
+	 */
+	static bool Decode(const std::string& filename, bool transparent, uint32_t flags, DecodedImage& image);
+
+	/**
+	 * Creates a bitmap from a decoded image and takes over its pixels.
+	 *
+	 * @param filename image file the image was decoded from.
+	 * @param image decoded image.
+	 * @param transparent allow transparency on bitmap, as passed to Decode.
+	 * @param flags bitmap flags, as passed to Decode.
+	 */
+	static BitmapRef Create(const std::string& filename, DecodedImage& image, bool transparent, uint32_t flags);
+
 	/*
 	 * Loads a bitmap from memory.
 	 *
@@ -116,6 +152,18 @@ public:
 	 */
 	static BitmapRef Create(Bitmap const& source, Rect const& src_rect, bool transparent = true);
 
+	/**
+	 * Creates a bitmap sharing the pixels of a rect of another one.
+	 * Nothing is copied, the view keeps the source alive and has its
+	 * pixel format. Meant for reading: drawing on either bitmap is
+	 * visible in the other one without changing the revision of the
+	 * other.
+	 *
+	 * @param source source bitmap.
+	 * @param src_rect rect of the source bitmap, clipped to its bounds.
+	 */
+	static BitmapRef CreateView(BitmapRef const& source, Rect const& src_rect);
+
 	/**
 	 * Creates a surface.
 	 *
@@ -161,6 +209,22 @@ public:
 	 */
 	Rect GetRect() const;
 
+	/**
+	 * Gets an identifier unique to this bitmap.
+	 * Identifiers are never reused, so they can be used as cache keys.
+	 *
+	 * @return bitmap identifier.
+	 */
+	unsigned GetId() const;
+
+	/**
+	 * Gets the revision of the bitmap contents.
+	 * The revision changes whenever the bitmap is drawn to.
+	 *
+	 * @return content revision.
+	 */
+	unsigned GetRevision() const;
+
 	/**
 	 * Gets if bitmap allows transparency.
 	 *
@@ -184,6 +248,49 @@ public:
 
 	static const uint32_t System  = 0x80000000;
 	static const uint32_t Chipset = 0x40000000;
+	/** Keep paletted images as indices, see IsIndexed. */
+	static const uint32_t Indexed = 0x20000000;
+
+	/**
+	 * Gets whether the pixels are indices into a palette.
+	 * Indexed bitmaps use a quarter of the memory and are expanded by
+	 * pixman while blitting. They are meant to be read only: drawing
+	 * onto them is not supported.
+	 *
+	 * @return whether the bitmap is indexed.
+	 */
+	bool IsIndexed() const;
+
+	/**
+	 * Gets the palette of an indexed bitmap.
+	 *
+	 * @return 256 premultiplied a8r8g8b8 entries, NULL if the bitmap is
+	 *         not indexed.
+	 */
+	const uint32_t* GetPalette() const;
+
+	/**
+	 * Creates an indexed bitmap from a rectangle of an indexed bitmap.
+	 * Effects that only depend on the color of a pixel (tone, hue) are
+	 * applied by passing a changed copy of the palette.
+	 *
+	 * @param source indexed source bitmap.
+	 * @param src_rect source bitmap rect.
+	 * @param flip_x flip the rect horizontally.
+	 * @param flip_y flip the rect vertically.
+	 * @param palette 256 premultiplied a8r8g8b8 entries.
+	 * @return new indexed bitmap.
+	 */
+	static BitmapRef CreateIndexed(Bitmap const& source, Rect const& src_rect,
+								   bool flip_x, bool flip_y, const uint32_t* palette);
+
+	/**
+	 * Sets whether paletted images requested with the Indexed flag are
+	 * kept indexed. Off by default except on low memory platforms.
+	 *
+	 * @param enabled whether to keep images indexed.
+	 */
+	static void SetIndexedImages(bool enabled);
 
 	enum TileOpacity {
 		Opaque,
@@ -193,6 +300,26 @@ public:
 
 	TileOpacity GetTileOpacity(int row, int col);
 
+	/** Opacity mask pool counters. */
+	struct MaskStats {
+		unsigned hits;
+		unsigned allocations;
+		size_t entries;
+	};
+
+	/**
+	 * Gets the opacity mask pool counters.
+	 * Allocations stop growing once all opacity values in use are pooled.
+	 *
+	 * @return mask pool counters.
+	 */
+	static MaskStats GetMaskStats();
+
+	/**
+	 * Releases all pooled opacity masks.
+	 */
+	static void ClearMaskPool();
+
 	/**
 	 * Writes PNG converted bitmap to output stream.
 	 *
@@ -207,7 +334,7 @@ public:
 	 *
 	 * @return background color.
 	 */
-	Color GetBackgroundColor();
+	Color GetBackgroundColor() const;
 
 	/**
 	 * Gets the shadow color
@@ -215,7 +342,7 @@ public:
 	 *
 	 * @return shadow color.
 	 */
-	Color GetShadowColor();
+	Color GetShadowColor() const;
 
 protected:
 	Bitmap();
@@ -243,6 +370,20 @@ protected:
 	boost::scoped_ptr<opacity_type> opacity;
 	Color bg_color, sh_color;
 
+	/** Unique bitmap identifier. */
+	unsigned id;
+
+	/** Content revision, bumped by RefreshCallback. */
+	unsigned revision;
+
+	/** Palette of indexed bitmaps. */
+	EASYRPG_SHARED_PTR<pixman_indexed_t> indexed;
+
+	/** Bitmap owning the pixels of a view. */
+	BitmapRef parent;
+
+	void InitIndexed(int width, int height, void* data, const uint32_t* palette, bool transparent);
+
 	void InitBitmap();
 
 public:
@@ -258,6 +399,17 @@ public:
 	*/
 	static BitmapRef Create(void *pixels, int width, int height, int pitch, const DynamicFormat& format);
 
+	/**
+	 * Creates a surface with its pixels in the frame arena.
+	 * The bitmap must be destroyed before the frame ends, see FrameArena.
+	 * The pixels are not initialized.
+	 *
+	 * @param width surface width.
+	 * @param height surface height.
+	 * @param transparent allow transparency on surface.
+	 */
+	static BitmapRef CreateTransient(int width, int height, bool transparent = true);
+
 	/**
 	 * Blits source bitmap to this one.
 	 *
@@ -336,6 +488,8 @@ public:
 
 	/**
 	 * Blits source bitmap with waver effect.
+	 * Only src_rect is drawn, the wave phase of a row depends on its
+	 * position in the image, starting at phase_row for src_rect.y.
 	 *
 	 * @param x x position.
 	 * @param y y position.
@@ -345,9 +499,11 @@ public:
 	 * @param src_rect source bitmap rect.
 	 * @param depth wave magnitude.
 	 * @param phase wave phase.
+	 * @param phase_row image row of src_rect.y, differs from it when src
+	 *                  is a cropped copy of the image.
 	 * @param opacity opacity.
 	 */
-	void WaverBlit(int x, int y, double zoom_x, double zoom_y, Bitmap const& src, Rect const& src_rect, int depth, double phase, Opacity const& opacity);
+	void WaverBlit(int x, int y, double zoom_x, double zoom_y, Bitmap const& src, Rect const& src_rect, int depth, double phase, int phase_row, Opacity const& opacity);
 
 	/**
 	 * Fills entire bitmap with color.
@@ -389,6 +545,7 @@ public:
 
 	/**
 	 * Adjusts bitmap tone.
+	 * Each pixel is toned in proportion to its alpha in src.
 	 *
 	 * @param x x position.
 	 * @param y y position.
@@ -485,12 +642,13 @@ public:
 	 * @param angle rotation angle.
 	 * @param waver_depth wave magnitude.
 	 * @param waver_phase wave phase.
+	 * @param waver_row image row of src_rect.y, see WaverBlit.
 	 */
 	void EffectsBlit(int x, int y, int ox, int oy,
 							 Bitmap const& src, Rect const& src_rect,
 							 Opacity const& opacity,
 							 double zoom_x, double zoom_y, double angle,
-							 int waver_depth, double waver_phase);
+							 int waver_depth, double waver_phase, int waver_row);
 
 	/**
 	 * Blits source bitmap with tone, opacity and scaling.
@@ -537,12 +695,13 @@ private:
 	 * @param opacity opacity.
 	 * @param waver_depth wave magnitude.
 	 * @param waver_phase wave phase.
+	 * @param waver_row image row of src_rect.y, see WaverBlit.
 	 */
 	void EffectsBlit(int x, int y, int ox, int oy,
 							 Bitmap const& src, Rect const& src_rect,
 							 Opacity const& opacity,
 							 double zoom_x, double zoom_y,
-							 int waver_depth, double waver_phase);
+							 int waver_depth, double waver_phase, int waver_row);
 
 	/**
 	 * Blits source bitmap with zoom and opacity scaling.
@@ -674,6 +833,7 @@ protected:
 public:
 	Bitmap(int width, int height, bool transparent);
 	Bitmap(const std::string& filename, bool transparent, uint32_t flags);
+	Bitmap(const std::string& filename, DecodedImage& image, bool transparent, uint32_t flags);
 	Bitmap(const uint8_t* data, unsigned bytes, bool transparent, uint32_t flags);
 	Bitmap(Bitmap const& source, Rect const& src_rect, bool transparent);
 	Bitmap(void *pixels, int width, int height, int pitch, const DynamicFormat& format);
@@ -704,8 +864,26 @@ protected:
 	void ReadXYZ(const uint8_t *data, unsigned len);
 	void ReadXYZ(FILE *stream);
 	void ConvertImage(int& width, int& height, void*& pixels, bool transparent);
+	void InitDecoded(const std::string& filename, DecodedImage& image, bool transparent, uint32_t flags);
 
 	static pixman_image_t* GetSubimage(Bitmap const& src, const Rect& src_rect);
+
+	/**
+	 * Single pass ToneBlit for 32 bit surfaces with 8 bit channels.
+	 *
+	 * @return false if the formats are not supported and the pixman
+	 *         path must be used instead.
+	 */
+	bool ToneBlitFast(int x, int y, Bitmap const& src, Rect const& src_rect, const Tone &tone);
+
+	/**
+	 * WaverBlit for 32 bit surfaces with 8 bit channels, writing rows directly.
+	 *
+	 * @return false if the formats are not supported and the pixman
+	 *         path must be used instead.
+	 */
+	bool WaverBlitFast(int x, int y, double zoom_x, double zoom_y, Bitmap const& src, Rect const& src_rect, int depth, double phase, int phase_row, Opacity const& opacity);
+
 	static inline void MultiplyAlpha(uint8_t &r, uint8_t &g, uint8_t &b, const uint8_t &a) {
 		r = (uint8_t)((int)r * a / 0xFF);
 		g = (uint8_t)((int)g * a / 0xFF);
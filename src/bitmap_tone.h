@@ -0,0 +1,242 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BITMAP_TONE_H_
+#define _BITMAP_TONE_H_
+
+// Headers
+#include <algorithm>
+#include "system.h"
+#include "tone.h"
+
+/*
+ * Single pass tone kernel.
+ *
+ * Reproduces the integer math of pixman's PIXMAN_OP_HSL_SATURATION and
+ * PIXMAN_OP_HARD_LIGHT unified combiners, so the result matches the
+ * composite based ToneBlit bit for bit. Pixels are handled as a8r8g8b8
+ * values and the mask is the alpha of the source pixel.
+ */
+
+static inline uint32_t Tone_DivOne(uint32_t x) {
+	x += 0x80;
+	return (x + (x >> 8)) >> 8;
+}
+
+static inline uint32_t Tone_Channel(uint32_t p, int shift) {
+	return (p >> shift) & 0xFF;
+}
+
+static inline uint32_t Tone_MulUn8(uint32_t p, uint32_t m) {
+	return (Tone_DivOne(Tone_Channel(p, 24) * m) << 24) |
+		(Tone_DivOne(Tone_Channel(p, 16) * m) << 16) |
+		(Tone_DivOne(Tone_Channel(p, 8) * m) << 8) |
+		Tone_DivOne(Tone_Channel(p, 0) * m);
+}
+
+// d * a + s * b per channel, saturated to 255
+static inline uint32_t Tone_MulAdd(uint32_t d, uint32_t a, uint32_t s, uint32_t b) {
+	uint32_t result = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		uint32_t c = Tone_DivOne(Tone_Channel(d, shift) * a) +
+			Tone_DivOne(Tone_Channel(s, shift) * b);
+		result |= std::min<uint32_t>(c, 0xFF) << shift;
+	}
+	return result;
+}
+
+static inline uint32_t Tone_HardLight(uint32_t dc, uint32_t da, uint32_t sc, uint32_t sa) {
+	if (2 * sc < sa)
+		return Tone_DivOne(2 * sc * dc);
+	return Tone_DivOne(sa * da - 2 * (da - dc) * (sa - sc));
+}
+
+static inline void Tone_SetSat(uint32_t c[3], uint32_t sat) {
+	int id[3];
+
+	if (c[0] > c[1]) {
+		if (c[0] > c[2]) {
+			id[0] = 0;
+			if (c[1] > c[2]) {
+				id[1] = 1; id[2] = 2;
+			} else {
+				id[1] = 2; id[2] = 1;
+			}
+		} else {
+			id[0] = 2; id[1] = 0; id[2] = 1;
+		}
+	} else {
+		if (c[0] > c[2]) {
+			id[0] = 1; id[1] = 0; id[2] = 2;
+		} else {
+			id[2] = 0;
+			if (c[1] > c[2]) {
+				id[0] = 1; id[1] = 2;
+			} else {
+				id[0] = 2; id[1] = 1;
+			}
+		}
+	}
+
+	uint32_t max = c[id[0]];
+	uint32_t min = c[id[2]];
+	if (max > min) {
+		c[id[1]] = (c[id[1]] - min) * sat / (max - min);
+		c[id[0]] = sat;
+		c[id[2]] = 0;
+	} else {
+		c[0] = c[1] = c[2] = 0;
+	}
+}
+
+static inline void Tone_SetLum(uint32_t c[3], uint32_t sa, uint32_t lum) {
+	const double mask = 255.0;
+	double a = sa * (1.0 / mask);
+	double l = lum * (1.0 / mask);
+	double tmp[3];
+
+	for (int i = 0; i < 3; i++)
+		tmp[i] = c[i] * (1.0 / mask);
+
+	l = l - (tmp[0] * 30 + tmp[1] * 59 + tmp[2] * 11) / 100;
+	for (int i = 0; i < 3; i++)
+		tmp[i] += l;
+
+	// ClipColor
+	l = (tmp[0] * 30 + tmp[1] * 59 + tmp[2] * 11) / 100;
+	double min = std::min(tmp[0], std::min(tmp[1], tmp[2]));
+	double max = std::max(tmp[0], std::max(tmp[1], tmp[2]));
+
+	if (min < 0) {
+		for (int i = 0; i < 3; i++)
+			tmp[i] = (l - min == 0.0) ? 0 : l + (tmp[i] - l) * l / (l - min);
+	}
+	if (max > a) {
+		for (int i = 0; i < 3; i++)
+			tmp[i] = (max - l == 0.0) ? a : l + (tmp[i] - l) * (a - l) / (max - l);
+	}
+
+	for (int i = 0; i < 3; i++)
+		c[i] = (uint32_t) (tmp[i] * mask + 0.5);
+}
+
+/** PIXMAN_OP_HSL_SATURATION of the masked source s onto d. */
+static inline uint32_t Tone_Saturation(uint32_t s, uint32_t d) {
+	uint32_t sa = s >> 24;
+	uint32_t da = d >> 24;
+	uint32_t result = Tone_MulAdd(d, 0xFF - sa, s, 0xFF - da);
+
+	uint32_t sc[3] = { Tone_Channel(s, 16), Tone_Channel(s, 8), Tone_Channel(s, 0) };
+	uint32_t dc[3] = { Tone_Channel(d, 16), Tone_Channel(d, 8), Tone_Channel(d, 0) };
+	uint32_t c[3] = { dc[0] * sa, dc[1] * sa, dc[2] * sa };
+
+	uint32_t sat = std::max(sc[0], std::max(sc[1], sc[2])) -
+		std::min(sc[0], std::min(sc[1], sc[2]));
+	Tone_SetSat(c, sat * da);
+	Tone_SetLum(c, sa * da, (dc[0] * 30 + dc[1] * 59 + dc[2] * 11) / 100 * sa);
+
+	return result + (Tone_DivOne(sa * da) << 24) +
+		(Tone_DivOne(c[0]) << 16) + (Tone_DivOne(c[1]) << 8) + Tone_DivOne(c[2]);
+}
+
+/** PIXMAN_OP_HARD_LIGHT of the masked source s onto d. */
+static inline uint32_t Tone_HardLightPixel(uint32_t s, uint32_t d) {
+	uint32_t sa = s >> 24;
+	uint32_t da = d >> 24;
+	uint32_t result = Tone_MulAdd(d, 0xFF - sa, s, 0xFF - da);
+
+	return result + (Tone_DivOne(sa * da) << 24) +
+		(Tone_HardLight(Tone_Channel(d, 16), da, Tone_Channel(s, 16), sa) << 16) +
+		(Tone_HardLight(Tone_Channel(d, 8), da, Tone_Channel(s, 8), sa) << 8) +
+		Tone_HardLight(Tone_Channel(d, 0), da, Tone_Channel(s, 0), sa);
+}
+
+/**
+ * Per-tone state of the fused kernel.
+ *
+ * Opaque pixels, the common case, use a lookup table per channel for the
+ * hard light step and a small memo for the saturation step.
+ */
+class ToneKernel {
+public:
+	ToneKernel(const Tone& tone) :
+		gray(0xFF000000 | ((uint32_t) tone.gray << 16)),
+		color(0xFF000000 | ((uint32_t) tone.red << 16) |
+			  ((uint32_t) tone.green << 8) | (uint32_t) tone.blue),
+		do_gray(tone.gray != 128),
+		do_color(tone.red != 128 || tone.green != 128 || tone.blue != 128) {
+		for (int c = 0; c < 256; c++) {
+			light[0][c] = (uint8_t) Tone_HardLight(c, 0xFF, tone.red, 0xFF);
+			light[1][c] = (uint8_t) Tone_HardLight(c, 0xFF, tone.green, 0xFF);
+			light[2][c] = (uint8_t) Tone_HardLight(c, 0xFF, tone.blue, 0xFF);
+		}
+		for (int i = 0; i < MEMO_SIZE; i++)
+			memo_key[i] = 0xFFFFFFFF;
+	}
+
+	/**
+	 * Applies the tone to a pixel.
+	 *
+	 * @param d a8r8g8b8 pixel, as it is after the OP_SRC copy.
+	 * @param m mask alpha (alpha of the source pixel).
+	 * @return toned a8r8g8b8 pixel.
+	 */
+	uint32_t Apply(uint32_t d, uint32_t m) {
+		if (m == 0)
+			return d;
+
+		if (m == 0xFF && (d >> 24) == 0xFF) {
+			if (do_gray)
+				d = Saturate(d);
+			if (do_color)
+				d = 0xFF000000 |
+					((uint32_t) light[0][Tone_Channel(d, 16)] << 16) |
+					((uint32_t) light[1][Tone_Channel(d, 8)] << 8) |
+					(uint32_t) light[2][Tone_Channel(d, 0)];
+			return d;
+		}
+
+		if (do_gray)
+			d = Tone_Saturation(Tone_MulUn8(gray, m), d);
+		if (do_color)
+			d = Tone_HardLightPixel(Tone_MulUn8(color, m), d);
+		return d;
+	}
+
+private:
+	enum { MEMO_SIZE = 1024 };
+
+	uint32_t Saturate(uint32_t d) {
+		uint32_t key = d & 0xFFFFFF;
+		int slot = (key ^ (key >> 10) ^ (key >> 20)) & (MEMO_SIZE - 1);
+		if (memo_key[slot] != key) {
+			memo_key[slot] = key;
+			memo_value[slot] = Tone_Saturation(gray, d);
+		}
+		return memo_value[slot];
+	}
+
+	uint32_t gray;
+	uint32_t color;
+	bool do_gray;
+	bool do_color;
+	uint8_t light[3][256];
+	uint32_t memo_key[MEMO_SIZE];
+	uint32_t memo_value[MEMO_SIZE];
+};
+
+#endif
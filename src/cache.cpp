@@ -20,6 +20,7 @@
 #  pragma warning(disable: 4003)
 #endif
 
+#include <list>
 #include <map>
 
 #include <boost/preprocessor/seq/for_each.hpp>
@@ -30,6 +31,8 @@
 #include "filefinder.h"
 #include "exfont.h"
 #include "bitmap.h"
+#include "bitmap_tone.h"
+#include "hslrgb.h"
 #include "output.h"
 #include "player.h"
 #include "data.h"
@@ -44,8 +47,185 @@ namespace {
 	typedef std::map<tile_pair, EASYRPG_WEAK_PTR<Bitmap> > cache_tiles_type;
 	cache_tiles_type cache_tiles;
 
+	// source id, revision, hue
+	typedef EASYRPG_ARRAY<unsigned, 3> hue_key;
+	typedef std::map<hue_key, EASYRPG_WEAK_PTR<Bitmap> > cache_hue_type;
+	cache_hue_type cache_hue;
+
 	static std::string system_name;
 
+	struct Preloaded;
+	typedef std::map<string_pair, Preloaded> preloaded_type;
+	typedef std::list<preloaded_type::iterator> preloaded_fifo;
+
+	struct Preloaded {
+		BitmapRef bitmap;
+		bool transparent;
+		preloaded_fifo::iterator order;
+	};
+
+	// Images decoded ahead of time, held until the next load takes them
+	// over. Requests may be polled and the image loaded frames later.
+	preloaded_type preloaded;
+	// Oldest first
+	preloaded_fifo preloaded_order;
+	size_t preloaded_bytes = 0;
+
+	// source id, revision, rect, flip x/y, tone, flash color
+	typedef EASYRPG_ARRAY<int, 16> effect_key;
+
+	struct Effect;
+	typedef std::map<effect_key, Effect> effect_map;
+	typedef std::list<effect_map::iterator> effect_lru;
+
+	struct Effect {
+		BitmapRef bitmap;
+		effect_lru::iterator lru;
+	};
+
+	effect_map effects;
+	// Most recently used first
+	effect_lru effects_lru;
+	size_t effects_bytes = 0;
+	size_t effects_limit = 4 * 1024 * 1024;
+
+	size_t BitmapBytes(Bitmap const& bitmap) {
+		return bitmap.pitch() * bitmap.height();
+	}
+
+	// Eviction order of retained assets, lowest first
+	enum Priority {
+		Priority_Low,
+		Priority_Normal,
+		Priority_Pinned
+	};
+
+	struct Retained;
+	typedef std::map<string_pair, Retained> retained_map;
+	typedef std::list<retained_map::iterator> retained_lru;
+
+	struct Retained {
+		BitmapRef bitmap;
+		Priority priority;
+		retained_lru::iterator lru;
+	};
+
+	// Strong references to recently loaded assets, so switching maps or
+	// leaving a menu doesn't decode them again
+	retained_map retained;
+	// Most recently used first
+	retained_lru retained_order;
+	size_t retained_bytes = 0;
+	size_t retained_limit = 16 * 1024 * 1024;
+	Cache::Stats stats = { 0, 0, 0, 0 };
+
+	void EvictRetained(size_t limit) {
+		for (int priority = Priority_Low; priority < Priority_Pinned && retained_bytes > limit; ++priority) {
+			retained_lru::iterator i = retained_order.end();
+			while (retained_bytes > limit && i != retained_order.begin()) {
+				--i;
+				retained_map::iterator const it = *i;
+				// Still used, dropping the reference would not free anything
+				if (it->second.priority != priority || !it->second.bitmap.unique())
+					continue;
+
+				retained_bytes -= BitmapBytes(*it->second.bitmap);
+				i = retained_order.erase(i);
+				retained.erase(it);
+				++stats.evictions;
+			}
+		}
+	}
+
+	void Retain(string_pair const& key, BitmapRef const& bitmap, Priority priority) {
+		retained_map::iterator it = retained.find(key);
+		if (it != retained.end()) {
+			retained_order.splice(retained_order.begin(), retained_order, it->second.lru);
+			if (it->second.bitmap == bitmap)
+				return;
+			retained_bytes -= BitmapBytes(*it->second.bitmap);
+		} else {
+			it = retained.insert(std::make_pair(key, Retained())).first;
+			retained_order.push_front(it);
+			it->second.lru = retained_order.begin();
+		}
+
+		it->second.bitmap = bitmap;
+		it->second.priority = priority;
+		retained_bytes += BitmapBytes(*bitmap);
+
+		EvictRetained(retained_limit);
+	}
+
+	void ErasePreloaded(preloaded_type::iterator it) {
+		preloaded_bytes -= BitmapBytes(*it->second.bitmap);
+		preloaded_order.erase(it->second.order);
+		preloaded.erase(it);
+	}
+
+	void EvictEffects(size_t limit) {
+		effect_lru::iterator i = effects_lru.end();
+		while (effects_bytes > limit && i != effects_lru.begin()) {
+			--i;
+			effect_map::iterator const it = *i;
+			// Still shown by a sprite, the memory can't be released
+			if (!it->second.bitmap.unique())
+				continue;
+
+			effects_bytes -= BitmapBytes(*it->second.bitmap);
+			i = effects_lru.erase(i);
+			effects.erase(it);
+		}
+	}
+
+	BitmapRef RenderEffect(Bitmap const& bitmap, Rect const& rect,
+						   bool flip_x, bool flip_y, Tone const& tone, Color const& blend) {
+		// Tone and flips of an indexed image only change the palette and
+		// the order of the indices
+		if (bitmap.IsIndexed() && blend.alpha == 0) {
+			const uint32_t* source_palette = bitmap.GetPalette();
+			uint32_t palette[256];
+			ToneKernel kernel(tone);
+			for (int i = 0; i < 256; i++)
+				palette[i] = kernel.Apply(source_palette[i], source_palette[i] >> 24);
+			return Bitmap::CreateIndexed(bitmap, rect, flip_x, flip_y, palette);
+		}
+
+		BitmapRef effect = Bitmap::Create(rect.width, rect.height, true);
+		Rect const dst_rect = effect->GetRect();
+
+		bool no_tone = tone == Tone();
+		bool no_flash = blend.alpha == 0;
+		bool no_flip = !flip_x && !flip_y;
+
+		effect->Clear();
+		if (no_tone && no_flash)
+			effect->FlipBlit(0, 0, bitmap, rect, flip_x, flip_y);
+		else if (no_flip && no_flash)
+			effect->ToneBlit(0, 0, bitmap, rect, tone);
+		else if (no_flip && no_tone)
+			effect->BlendBlit(0, 0, bitmap, rect, blend);
+		else if (no_flash) {
+			effect->ToneBlit(0, 0, bitmap, rect, tone);
+			effect->Flip(dst_rect, flip_x, flip_y);
+		}
+		else if (no_tone) {
+			effect->BlendBlit(0, 0, bitmap, rect, blend);
+			effect->Flip(dst_rect, flip_x, flip_y);
+		}
+		else if (no_flip) {
+			effect->BlendBlit(0, 0, bitmap, rect, blend);
+			effect->ToneBlit(0, 0, *effect, dst_rect, tone);
+		}
+		else {
+			effect->BlendBlit(0, 0, bitmap, rect, blend);
+			effect->ToneBlit(0, 0, *effect, dst_rect, tone);
+			effect->Flip(dst_rect, flip_x, flip_y);
+		}
+
+		return effect;
+	}
+
 	BitmapRef LoadBitmap(std::string const& folder_name, const std::string& filename,
 						 bool transparent, uint32_t const flags) {
 		string_pair const key(folder_name, filename);
@@ -53,14 +233,30 @@ namespace {
 		cache_type::const_iterator const it = cache.find(key);
 
 		if (it == cache.end() || it->second.expired()) {
+			preloaded_type::iterator const pre = preloaded.find(key);
+			if (pre != preloaded.end()) {
+				BitmapRef const bitmap = pre->second.bitmap;
+				bool const usable = pre->second.transparent == transparent;
+				ErasePreloaded(pre);
+
+				if (bitmap && usable) {
+					++stats.misses;
+					return (cache[key] = bitmap).lock();
+				}
+			}
+
 			std::string const path = FileFinder::FindImage(folder_name, filename);
 
 			if (path.empty()) {
 				return BitmapRef();
 			}
 
+			++stats.misses;
 			return (cache[key] = Bitmap::Create(path, transparent, flags)).lock();
-		} else { return it->second.lock(); }
+		} else {
+			++stats.hits;
+			return it->second.lock();
+		}
 	}
 
 	struct Material {
@@ -111,6 +307,20 @@ namespace {
 		{ "Frame", true, 320, 320, 240, 240 },
 	};
 
+	uint32_t MaterialFlags(Material::Type T) {
+		uint32_t flags =
+			T == Material::Chipset? Bitmap::Chipset:
+			T == Material::System? Bitmap::System:
+			0;
+
+		// Images that are only read from can stay paletted
+		if (T == Material::Charset || T == Material::Chipset || T == Material::Faceset ||
+			T == Material::Monster || T == Material::Battlecharset || T == Material::Battleweapon)
+			flags |= Bitmap::Indexed;
+
+		return flags;
+	}
+
 	template<Material::Type T>
 	BitmapRef LoadDummyBitmap(std::string const& folder_name, const std::string& filename) {
 		BOOST_STATIC_ASSERT(Material::REND < T && T < Material::END);
@@ -152,10 +362,7 @@ namespace {
 			return BitmapRef();
 		}
 
-		BitmapRef ret = LoadBitmap(s.directory, f, transparent,
-										 T == Material::Chipset? Bitmap::Chipset:
-										 T == Material::System? Bitmap::System:
-										 0);
+		BitmapRef ret = LoadBitmap(s.directory, f, transparent, MaterialFlags(T));
 
 		if (!ret) {
 			Output::Warning("Image not found: %s/%s", s.directory, f.c_str());
@@ -163,6 +370,12 @@ namespace {
 			return LoadDummyBitmap<T>(s.directory, f);
 		}
 
+		Retain(string_pair(s.directory, f), ret,
+			   T == Material::System || T == Material::Chipset ? Priority_Pinned :
+			   T == Material::Charset || T == Material::Faceset || T == Material::Monster ||
+			   T == Material::Battlecharset || T == Material::Battleweapon || T == Material::System2 ?
+			   Priority_Normal : Priority_Low);
+
 		if(
 			ret->GetWidth () < s.min_width  || s.max_width  < ret->GetWidth () ||
 			ret->GetHeight() < s.min_height || s.max_height < ret->GetHeight()
@@ -232,11 +445,144 @@ BitmapRef Cache::Tile(const std::string& filename, int tile_id) {
 		rect.x += sub_tile_id % 6 * 16;
 		rect.y += sub_tile_id / 6 * 16;
 
-		return(cache_tiles[key] = Bitmap::Create(*chipset, rect)).lock();
+		return(cache_tiles[key] = Bitmap::CreateView(chipset, rect)).lock();
+	} else { return it->second.lock(); }
+}
+
+BitmapRef Cache::HueChange(BitmapRef const& src_bitmap, int hue) {
+	hue_key key;
+	key[0] = src_bitmap->GetId();
+	key[1] = src_bitmap->GetRevision();
+	key[2] = hue;
+
+	cache_hue_type::const_iterator const it = cache_hue.find(key);
+
+	if (it == cache_hue.end() || it->second.expired()) {
+		BitmapRef bitmap;
+		if (src_bitmap->IsIndexed()) {
+			// Rotate the palette, kept as r8g8b8a8 like HueChangeBlit
+			const uint32_t* source_palette = src_bitmap->GetPalette();
+			uint32_t palette[256];
+			for (int i = 0; i < 256; i++)
+				palette[i] = (source_palette[i] << 8) | (source_palette[i] >> 24);
+			HueRotation rotation(hue);
+			rotation.Row(palette, 256);
+			for (int i = 0; i < 256; i++)
+				palette[i] = (palette[i] >> 8) | (palette[i] << 24);
+			bitmap = Bitmap::CreateIndexed(*src_bitmap, src_bitmap->GetRect(), false, false, palette);
+		} else {
+			bitmap = Bitmap::Create(src_bitmap->GetWidth(), src_bitmap->GetHeight());
+			bitmap->HueChangeBlit(0, 0, *src_bitmap, src_bitmap->GetRect(), hue);
+		}
+		return (cache_hue[key] = bitmap).lock();
 	} else { return it->second.lock(); }
 }
 
+BitmapRef Cache::SpriteEffect(BitmapRef const& src_bitmap, Rect const& rect,
+							  bool flip_x, bool flip_y, Tone const& tone, Color const& blend) {
+	effect_key key;
+	key[0] = src_bitmap->GetId();
+	key[1] = src_bitmap->GetRevision();
+	key[2] = rect.x;
+	key[3] = rect.y;
+	key[4] = rect.width;
+	key[5] = rect.height;
+	key[6] = flip_x;
+	key[7] = flip_y;
+	key[8] = tone.red;
+	key[9] = tone.green;
+	key[10] = tone.blue;
+	key[11] = tone.gray;
+	key[12] = blend.red;
+	key[13] = blend.green;
+	key[14] = blend.blue;
+	key[15] = blend.alpha;
+
+	effect_map::iterator const it = effects.find(key);
+	if (it != effects.end()) {
+		effects_lru.splice(effects_lru.begin(), effects_lru, it->second.lru);
+		return it->second.bitmap;
+	}
+
+	BitmapRef const effect = RenderEffect(*src_bitmap, rect, flip_x, flip_y, tone, blend);
+
+	size_t const bytes = BitmapBytes(*effect);
+	if (bytes <= effects_limit) {
+		EvictEffects(effects_limit - bytes);
+
+		effect_map::iterator const inserted = effects.insert(std::make_pair(key, Effect())).first;
+		inserted->second.bitmap = effect;
+		effects_lru.push_front(inserted);
+		inserted->second.lru = effects_lru.begin();
+		effects_bytes += bytes;
+	}
+
+	return effect;
+}
+
+void Cache::SetSpriteEffectLimit(size_t bytes) {
+	effects_limit = bytes;
+	EvictEffects(effects_limit);
+}
+
+void Cache::SetRetainLimit(size_t bytes) {
+	retained_limit = bytes;
+	EvictRetained(retained_limit);
+}
+
+size_t Cache::GetPreloadRoom() {
+	return retained_limit > preloaded_bytes ? retained_limit - preloaded_bytes : 0;
+}
+
+Cache::Stats Cache::GetStats() {
+	stats.retained_bytes = retained_bytes;
+	return stats;
+}
+
+bool Cache::GetImageParams(const std::string& directory, bool& transparent, uint32_t& flags) {
+	for (int i = 0; i < Material::END; ++i) {
+		if (directory == spec[i].directory) {
+			transparent = spec[i].transparent;
+			flags = MaterialFlags(static_cast<Material::Type>(i));
+			return true;
+		}
+	}
+	return false;
+}
+
+void Cache::AddPreloaded(const std::string& directory, const std::string& filename,
+						 BitmapRef const& bitmap, bool transparent) {
+	string_pair const key(directory, filename);
+	preloaded_type::iterator it = preloaded.find(key);
+	if (it != preloaded.end()) {
+		ErasePreloaded(it);
+	}
+
+	it = preloaded.insert(std::make_pair(key, Preloaded())).first;
+	it->second.bitmap = bitmap;
+	it->second.transparent = transparent;
+	it->second.order = preloaded_order.insert(preloaded_order.end(), it);
+	preloaded_bytes += BitmapBytes(*bitmap);
+
+	// Bounded like the retained images, the oldest are dropped first
+	while (preloaded_bytes > retained_limit && preloaded_order.front() != it) {
+		ErasePreloaded(preloaded_order.front());
+	}
+}
+
 void Cache::Clear() {
+	effects.clear();
+	effects_lru.clear();
+	effects_bytes = 0;
+
+	retained.clear();
+	retained_order.clear();
+	retained_bytes = 0;
+
+	preloaded.clear();
+	preloaded_order.clear();
+	preloaded_bytes = 0;
+
 	for(cache_type::const_iterator i = cache.begin(); i != cache.end(); ++i) {
 		if(i->second.expired()) { continue; }
 		Output::Debug("possible leak in cached bitmap %s/%s",
@@ -250,6 +596,8 @@ void Cache::Clear() {
 					  i->first.first.c_str(), i->first.second);
 	}
 	cache_tiles.clear();
+
+	cache_hue.clear();
 }
 
 void Cache::SetSystemName(std::string const& filename) {
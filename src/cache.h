@@ -23,6 +23,8 @@
 
 #include "system.h"
 #include "color.h"
+#include "rect.h"
+#include "tone.h"
 #include "memory_management.h"
 
 /**
@@ -48,6 +50,100 @@ namespace Cache {
 	BitmapRef System2(const std::string& filename);
 	BitmapRef Tile(const std::string& filename, int tile_id);
 
+	/**
+	 * Gets a hue shifted copy of a bitmap.
+	 * The copy is shared as long as somebody holds a reference to it.
+	 *
+	 * @param src_bitmap source bitmap.
+	 * @param hue hue change in degrees.
+	 * @return hue shifted bitmap.
+	 */
+	BitmapRef HueChange(BitmapRef const& src_bitmap, int hue);
+
+	/**
+	 * Gets the tone, flash and flip variant of a bitmap area.
+	 * Identical variants are computed once and shared by all callers.
+	 * The returned bitmap has the size of rect.
+	 *
+	 * @param src_bitmap source bitmap.
+	 * @param rect source bitmap rect.
+	 * @param flip_x flip horizontally.
+	 * @param flip_y flip vertically.
+	 * @param tone tone to apply.
+	 * @param blend flash color to blend with.
+	 * @return effect bitmap.
+	 */
+	BitmapRef SpriteEffect(BitmapRef const& src_bitmap, Rect const& rect,
+						   bool flip_x, bool flip_y, Tone const& tone, Color const& blend);
+
+	/**
+	 * Sets the memory budget of the sprite effect cache.
+	 * Variants still used by a sprite are never evicted.
+	 *
+	 * @param bytes budget in bytes.
+	 */
+	void SetSpriteEffectLimit(size_t bytes);
+
+	/**
+	 * Sets the memory budget for keeping loaded images alive after the
+	 * last user released them. Least recently used images are dropped
+	 * first, pictures and backgrounds before sprites. System graphics
+	 * and chipsets are never dropped.
+	 *
+	 * @param bytes budget in bytes, 0 only keeps pinned images.
+	 */
+	void SetRetainLimit(size_t bytes);
+
+	/**
+	 * Gets how many bytes of preloaded images the cache can still hold
+	 * without dropping others, see AddPreloaded.
+	 *
+	 * @return room in bytes.
+	 */
+	size_t GetPreloadRoom();
+
+	/** Image cache statistics. */
+	struct Stats {
+		/** Loads served by an image in memory. */
+		unsigned hits;
+		/** Loads that decoded the image file. */
+		unsigned misses;
+		/** Images dropped to stay within the budget. */
+		unsigned evictions;
+		/** Bytes of the images kept alive. */
+		size_t retained_bytes;
+	};
+
+	/**
+	 * Gets the image cache statistics.
+	 *
+	 * @return statistics.
+	 */
+	Stats GetStats();
+
+	/**
+	 * Gets how images of a directory are loaded by default.
+	 *
+	 * @param directory image directory.
+	 * @param transparent receives whether transparency is allowed.
+	 * @param flags receives the bitmap flags.
+	 * @return false if the directory doesn't hold cached images.
+	 */
+	bool GetImageParams(const std::string& directory, bool& transparent, uint32_t& flags);
+
+	/**
+	 * Offers an image decoded ahead of time. The next load of the file
+	 * takes it over when the transparency matches. Until then it is
+	 * held, the oldest are dropped beyond the retain budget.
+	 *
+	 * @param directory image directory.
+	 * @param filename image name, as passed to the load.
+	 * @param bitmap decoded image.
+	 * @param transparent whether the image was loaded with transparency.
+	 */
+	void AddPreloaded(const std::string& directory, const std::string& filename,
+					  BitmapRef const& bitmap, bool transparent);
+
 	void Clear();
 
 	BitmapRef System();
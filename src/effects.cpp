@@ -39,9 +39,9 @@ void Bitmap::EffectsBlit(int x, int y, int ox, int oy,
 						   Bitmap const& src, Rect const& src_rect,
 						   Opacity const& opacity,
 						   double zoom_x, double zoom_y,
-						   int waver_depth, double waver_phase) {
+						   int waver_depth, double waver_phase, int waver_row) {
 	WaverBlit(x - ox * zoom_x, y - oy * zoom_y, zoom_x, zoom_y, src, src_rect,
-				waver_depth, waver_phase, opacity);
+				waver_depth, waver_phase, waver_row, opacity);
 }
 
 // Zoom, Opacity
@@ -72,7 +72,7 @@ void Bitmap::EffectsBlit(int x, int y, int ox, int oy,
 						   Bitmap const& src, Rect const& src_rect,
 						   Opacity const& opacity,
 						   double zoom_x, double zoom_y, double angle,
-						   int waver_depth, double waver_phase) {
+						   int waver_depth, double waver_phase, int waver_row) {
 	bool rotate = angle != 0.0;
 	bool scale = zoom_x != 1.0 || zoom_y != 1.0;
 	bool waver = waver_depth != 0;
@@ -81,7 +81,7 @@ void Bitmap::EffectsBlit(int x, int y, int ox, int oy,
 		EffectsBlit(x, y, ox, oy, src, src_rect,
 					opacity,
 					zoom_x, zoom_y,
-					waver_depth, waver_phase);
+					waver_depth, waver_phase, waver_row);
 	}
 	else if (rotate) {
 		Matrix fwd = Matrix::Setup(-angle, zoom_x, zoom_y, ox, oy, x, y);
@@ -113,7 +113,7 @@ void Bitmap::EffectsBlit(int x, int y, int ox, int oy, Bitmap const& src, Rect c
 		}
 
 		bool transparent = src.GetTransparent();
-		draw_ = Create(src_rect.width, src_rect.height, transparent);
+		draw_ = CreateTransient(src_rect.width, src_rect.height, transparent);
 		if (transparent)
 			draw_->Clear();
 		draw_->ToneBlit(0, 0, src, src_rect, tone);
@@ -16,6 +16,7 @@
  */
 
 // Headers
+#include <cctype>
 #include <cerrno>
 #include <cstdio>
 #include <cstring>
@@ -30,14 +31,17 @@
 #include <vector>
 
 #include <boost/optional.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "system.h"
 #include "options.h"
 #include "utils.h"
+#include "asset_pack.h"
 #include "filefinder.h"
 #include "output.h"
 #include "player.h"
 #include "main_data.h"
+#include "project_index.h"
 #include "reader_util.h"
 #include "registry.h"
 
@@ -56,6 +60,7 @@
 #ifdef _WIN32
 #  include <windows.h>
 #  include <shlobj.h>
+#  include <sys/stat.h>
 #else
 #  include <dirent.h>
 #  include <unistd.h>
@@ -122,6 +127,27 @@ namespace {
 		return std::find_if(n.begin(), n.end(), &is_not_ascii_char) != n.end();
 	}
 
+	/**
+	 * Gets the RTP table from translated to English names.
+	 * When several English names share a translation the alphabetically
+	 * first one is used.
+	 */
+	rtp_table_type const& reverse_rtp_table(rtp_table_type const& table) {
+		static rtp_table_type reverse_2000;
+		static rtp_table_type reverse_2003;
+
+		rtp_table_type& reverse = &table == &RTP_TABLE_2000 ? reverse_2000 : reverse_2003;
+		if (reverse.empty()) {
+			for (rtp_table_type::const_iterator dir_it = table.begin(); dir_it != table.end(); ++dir_it) {
+				std::map<std::string, std::string>& files = reverse[dir_it->first];
+				for (std::map<std::string, std::string>::const_iterator it = dir_it->second.begin(); it != dir_it->second.end(); ++it) {
+					files.insert(std::make_pair(it->second, it->first));
+				}
+			}
+		}
+		return reverse;
+	}
+
 	std::string const& translate_rtp(std::string const& dir, std::string const& name) {
 		rtp_table_type const& table =
 			Player::IsRPG2k() ? RTP_TABLE_2000 : RTP_TABLE_2003;
@@ -135,11 +161,12 @@ namespace {
 			dir_it->second.find(lower_name);
 		if (file_it == dir_it->second.end()) {
 			if (is_not_ascii_filename(lower_name)) {
-				// Linear Search: Japanese file name to English file name
-				for (std::map<std::string, std::string>::const_iterator it = dir_it->second.begin(); it != file_it; ++it) {
-					if (it->second == lower_name) {
-						return it->first;
-					}
+				// Japanese file name to English file name
+				std::map<std::string, std::string> const& reverse =
+					reverse_rtp_table(table).find(dir_it->first)->second;
+				std::map<std::string, std::string>::const_iterator const it = reverse.find(lower_name);
+				if (it != reverse.end()) {
+					return it->second;
 				}
 			}
 			return name;
@@ -147,7 +174,7 @@ namespace {
 		return file_it->second;
 	}
 
-	std::string FindFile(const std::string &dir, const std::string& name, const char* exts[]) {
+	std::string SearchFile(const std::string &dir, const std::string& name, const char* exts[]) {
 		FileFinder::ProjectTree const& tree = FileFinder::GetProjectTree();
 		boost::optional<std::string> const ret = FindFile(tree, dir, name, exts);
 		if (ret != boost::none) { return *ret; }
@@ -170,11 +197,84 @@ namespace {
 		return std::string();
 	}
 
+	// Results of SearchFile, including misses, by directory, name and
+	// extension list. Names are compared case insensitive like the trees.
+	struct LookupKey {
+		std::string dir;
+		std::string name;
+		char const** exts;
+	};
+
+	/** Probe for a lookup, avoids copying the strings of the request. */
+	struct LookupRef {
+		std::string const& dir;
+		std::string const& name;
+		char const** exts;
+	};
+
+	inline size_t HashLower(std::string const& str, size_t hash) {
+		for (std::string::const_iterator c = str.begin(); c != str.end(); ++c) {
+			hash ^= (unsigned char) tolower((unsigned char) *c);
+			hash *= 16777619U;
+		}
+		return hash;
+	}
+
+	inline bool EqualLower(std::string const& a, std::string const& b) {
+		if (a.size() != b.size()) { return false; }
+		for (size_t i = 0; i < a.size(); ++i) {
+			if (tolower((unsigned char) a[i]) != tolower((unsigned char) b[i])) { return false; }
+		}
+		return true;
+	}
+
+	struct LookupHash {
+		size_t operator()(std::string const& dir, std::string const& name, char const** exts) const {
+			size_t hash = HashLower(name, HashLower(dir, 2166136261U) * 16777619U);
+			return hash ^ reinterpret_cast<size_t>(exts);
+		}
+		size_t operator()(LookupKey const& key) const { return (*this)(key.dir, key.name, key.exts); }
+		size_t operator()(LookupRef const& key) const { return (*this)(key.dir, key.name, key.exts); }
+	};
+
+	struct LookupEqual {
+		template<typename T>
+		bool operator()(T const& a, LookupKey const& b) const {
+			return a.exts == b.exts && EqualLower(a.name, b.name) && EqualLower(a.dir, b.dir);
+		}
+	};
+
+	typedef boost::unordered_map<LookupKey, std::string, LookupHash, LookupEqual> lookup_map;
+	lookup_map lookups;
+	unsigned lookup_hits = 0;
+
+	std::string FindFile(const std::string &dir, const std::string& name, const char* exts[]) {
+		// Rebuilding the project tree drops the lookups
+		FileFinder::GetProjectTree();
+
+		LookupRef const ref = { dir, name, exts };
+		lookup_map::const_iterator const it = lookups.find(ref, LookupHash(), LookupEqual());
+		if (it != lookups.end()) {
+			++lookup_hits;
+			return it->second;
+		}
+
+		LookupKey key;
+		key.dir = dir;
+		key.name = name;
+		key.exts = exts;
+		return lookups.insert(std::make_pair(key, SearchFile(dir, name, exts))).first->second;
+	}
+
 } // anonymous namespace
 
 EASYRPG_SHARED_PTR<FileFinder::ProjectTree> FileFinder::CreateProjectTree(std::string const& p, bool recursive) {
 	if(! (Exists(p) && IsDirectory(p))) { return EASYRPG_SHARED_PTR<ProjectTree>(); }
 
+	if (ProjectIndex::IsEnabled()) {
+		return ProjectIndex::CreateProjectTree(p, recursive);
+	}
+
 	EASYRPG_SHARED_PTR<ProjectTree> tree = EASYRPG_MAKE_SHARED<ProjectTree>();
 	tree->project_path = p;
 
@@ -255,7 +355,7 @@ std::string GetFontFilename(std::string const& name) {
 std::string FileFinder::FindFont(const std::string& name) {
 	static const char* FONTS_TYPES[] = {
 		".ttf", ".ttc", ".otf", ".fon", NULL, };
-	std::string path = FindFile("Font", name, FONTS_TYPES);
+	std::string path = AssetPack::Extract(FindFile("Font", name, FONTS_TYPES));
 
 #ifdef _WIN32
 	if (!path.empty()) {
@@ -286,9 +386,17 @@ std::string FileFinder::FindFont(const std::string& name) {
 #endif
 }
 
+std::string const& FileFinder::TranslateRtp(const std::string& dir, const std::string& name) {
+	return translate_rtp(dir, name);
+}
+
 FileFinder::ProjectTree const& FileFinder::GetProjectTree(bool init) {
 	static ProjectTree tree_;
 
+	if (AssetPack::IsMounted()) {
+		return AssetPack::GetTree();
+	}
+
 	if(tree_.project_path != Main_Data::project_path || init) {
 		EASYRPG_SHARED_PTR<ProjectTree> t = CreateProjectTree(Main_Data::project_path);
 		if(! t) {
@@ -296,6 +404,7 @@ FileFinder::ProjectTree const& FileFinder::GetProjectTree(bool init) {
 			return tree_;
 		}
 		tree_ = *t;
+		lookups.clear();
 	}
 
 	return tree_;
@@ -311,6 +420,7 @@ static void add_rtp_path(std::string const& p) {
 	if(tree) {
 		Output::Debug("Adding %s to RTP path", p.c_str());
 		search_paths.push_back(tree);
+		lookups.clear();
 	}
 }
 
@@ -396,6 +506,29 @@ void FileFinder::InitRtpPaths() {
 
 void FileFinder::Quit() {
 	search_paths.clear();
+	AssetPack::Unmount();
+
+	LookupStats const lookup_stats = GetLookupStats();
+	Output::Debug("File lookups: %u answered from %u cached results",
+				  lookup_stats.hits, lookup_stats.entries);
+	lookups.clear();
+
+	if (ProjectIndex::IsEnabled()) {
+		ProjectIndex::Stats const stats = ProjectIndex::GetStats();
+		Output::Debug("Project index: %u listings reused, %u directories read",
+					  stats.reused, stats.scanned);
+	}
+}
+
+void FileFinder::ClearLookups() {
+	lookups.clear();
+}
+
+FileFinder::LookupStats FileFinder::GetLookupStats() {
+	LookupStats stats;
+	stats.hits = lookup_hits;
+	stats.entries = lookups.size();
+	return stats;
 }
 
 FILE* FileFinder::fopenUTF8(const std::string& name_utf8, char const* mode) {
@@ -432,7 +565,7 @@ std::string FileFinder::FindImage(const std::string& dir, const std::string& nam
 
 std::string FileFinder::FindDefault(const std::string& dir, const std::string& name) {
 	static const char* no_exts[] = {"", NULL};
-	return FindFile(dir, name, no_exts);
+	return AssetPack::Extract(FindFile(dir, name, no_exts));
 }
 
 std::string FileFinder::FindDefault(std::string const& name) {
@@ -444,7 +577,7 @@ std::string FileFinder::FindDefault(const ProjectTree& tree, const std::string&
 
 	boost::optional<std::string> file = FindFile(tree, dir, name, no_exts);
 	if (file != boost::none) {
-		return *file;
+		return AssetPack::Extract(*file);
 	}
 	return "";
 }
@@ -455,7 +588,7 @@ std::string FileFinder::FindDefault(const ProjectTree& tree, const std::string&
 
 	string_map::const_iterator const it = files.find(Utils::LowerCase(name));
 
-	return(it != files.end()) ? MakePath(p.project_path, it->second) : "";
+	return(it != files.end()) ? AssetPack::Extract(MakePath(p.project_path, it->second)) : "";
 }
 
 bool FileFinder::IsRPG2kProject(ProjectTree const& dir) {
@@ -481,7 +614,7 @@ std::string FileFinder::FindMusic(const std::string& name) {
 
 	static const char* MUSIC_TYPES[] = {
 		".wav", ".ogg", ".mid", ".midi", ".mp3", NULL };
-	return FindFile("Music", name, MUSIC_TYPES);
+	return AssetPack::Extract(FindFile("Music", name, MUSIC_TYPES));
 }
 
 std::string FileFinder::FindSound(const std::string& name) {
@@ -491,7 +624,7 @@ std::string FileFinder::FindSound(const std::string& name) {
 
 	static const char* SOUND_TYPES[] = {
 		".wav", ".ogg", ".mp3", NULL };
-	return FindFile("Sound", name, SOUND_TYPES);
+	return AssetPack::Extract(FindFile("Sound", name, SOUND_TYPES));
 }
 
 bool FileFinder::Exists(std::string const& filename) {
@@ -505,6 +638,23 @@ bool FileFinder::Exists(std::string const& filename) {
 #endif
 }
 
+std::time_t FileFinder::GetModifiedTime(std::string const& file) {
+	if (AssetPack::IsPacked(file)) {
+		return GetModifiedTime(AssetPack::GetTree().project_path);
+	}
+
+#ifdef _WIN32
+	struct _stat sb;
+	if (::_wstat(Utils::ToWideString(file).c_str(), &sb) != 0)
+		return 0;
+#else
+	struct stat sb;
+	if (::stat(file.c_str(), &sb) != 0)
+		return 0;
+#endif
+	return sb.st_mtime;
+}
+
 bool FileFinder::IsDirectory(std::string const& dir) {
 	assert(Exists(dir));
 #ifdef _WIN32
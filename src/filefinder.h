@@ -21,6 +21,7 @@
 // Headers
 #include "system.h"
 
+#include <ctime>
 #include <string>
 #include <ios>
 #include <boost/container/flat_map.hpp>
@@ -48,6 +49,27 @@ namespace FileFinder {
 	 */
 	void Quit();
 
+	/**
+	 * Forgets the remembered results of FindFile.
+	 * Needed when files appear without a project tree rebuild.
+	 */
+	void ClearLookups();
+
+	/** Statistics of the remembered FindFile results. */
+	struct LookupStats {
+		/** Lookups answered from a remembered result. */
+		unsigned hits;
+		/** Remembered results, misses included. */
+		unsigned entries;
+	};
+
+	/**
+	 * Gets the statistics of the remembered FindFile results.
+	 *
+	 * @return statistics.
+	 */
+	LookupStats GetLookupStats();
+
 	/*
 	* { case lowered path, real path }
 	*/
@@ -132,6 +154,17 @@ namespace FileFinder {
 	 */
 	std::string FindFont(const std::string& name);
 
+	/**
+	 * Translates an RTP file name using the RTP table of the current
+	 * engine: English names to the translated name and translated names
+	 * back to English. Other names are returned unchanged.
+	 *
+	 * @param dir RTP directory of the file.
+	 * @param name file name without extension.
+	 * @return translated name.
+	 */
+	std::string const& TranslateRtp(const std::string& dir, const std::string& name);
+
 	/**
 	 * Opens a file specified by a UTF-8 string.
 	 *
@@ -172,6 +205,15 @@ namespace FileFinder {
 	 */
 	bool Exists(std::string const& file);
 
+	/**
+	 * Gets the last modification time of a file.
+	 *
+	 * @param file file to check.
+	 * @return modification time in seconds since the epoch, 0 if the
+	 *         file does not exist.
+	 */
+	std::time_t GetModifiedTime(std::string const& file);
+
 	/**
 	 * Checks whether file name exists in the directory.
 	 * This function is case insensitive.
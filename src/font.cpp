@@ -16,8 +16,10 @@
  */
 
 // Headers
+#include <algorithm>
 #include <map>
 #include <vector>
+#include <cstring>
 #include <ciso646>
 
 #include <boost/next_prior.hpp>
@@ -226,15 +228,152 @@ void Font::Dispose() {
 	face_cache.clear();
 }
 
+/**
+ * Glyph atlas.
+ * Glyphs are packed into shelves of fixed size pages that are
+ * allocated on demand. When max_pages is exceeded the atlas is
+ * emptied and filled again lazily.
+ */
+struct Font::GlyphCache {
+	typedef std::pair<unsigned, int> key_type;
+
+	struct Entry {
+		size_t page;
+		Rect rect;
+	};
+
+	typedef std::map<key_type, Entry> entry_map;
+
+	enum { PAGE_SIZE = 256 };
+
+	GlyphCache(bool alpha, size_t max_pages)
+		: alpha(alpha), max_pages(max_pages), shelf_x(0), shelf_y(0), shelf_height(0) {}
+
+	Entry const* Find(key_type const& key) const {
+		entry_map::const_iterator const it = entries.find(key);
+		return it == entries.end()? NULL : &it->second;
+	}
+
+	Entry const& Insert(key_type const& key, int width, int height) {
+		if (!pages.empty() && shelf_x + width > pages.back()->GetWidth()) {
+			// Start a new shelf
+			shelf_x = 0;
+			shelf_y += shelf_height;
+			shelf_height = 0;
+		}
+
+		if (pages.empty() || shelf_y + height > pages.back()->GetHeight()) {
+			if (pages.size() >= max_pages) {
+				Clear();
+			}
+
+			// Oversized glyphs get a page of their own
+			int const page_width = std::max<int>(PAGE_SIZE, width);
+			int const page_height = std::max<int>(PAGE_SIZE, height);
+			BitmapRef page = alpha
+				? Bitmap::Create(reinterpret_cast<void*>(NULL), page_width, page_height, 0, DynamicFormat(8,8,0,8,0,8,0,8,0,PF::Alpha))
+				: Bitmap::Create(page_width, page_height, true);
+			page->Clear();
+			pages.push_back(page);
+			shelf_x = shelf_y = shelf_height = 0;
+		}
+
+		Entry& entry = entries[key];
+		entry.page = pages.size() - 1;
+		entry.rect = Rect(shelf_x, shelf_y, width, height);
+
+		shelf_x += width;
+		shelf_height = std::max(shelf_height, height);
+
+		return entry;
+	}
+
+	void Clear() {
+		pages.clear();
+		entries.clear();
+		shelf_x = shelf_y = shelf_height = 0;
+	}
+
+	bool const alpha;
+	size_t const max_pages;
+	std::vector<BitmapRef> pages;
+	entry_map entries;
+	int shelf_x, shelf_y, shelf_height;
+};
+
 // Constructor.
 Font::Font(const std::string& name, int size, bool bold, bool italic)
 	: name(name)
 	, size(size)
 	, bold(bold)
 	, italic(italic)
+	, glyph_cache(new GlyphCache(true, 16))
+	, tint_cache(new GlyphCache(false, 8))
+	, tint_system(0)
+	, cache_name(name)
+	, cache_size(size)
+	, cache_bold(bold)
+	, cache_italic(italic)
 {
 }
 
+void Font::CheckGlyphCache() {
+	// name and size are public and may change after glyphs were cached
+	if (cache_size != size || cache_bold != bold || cache_italic != italic || cache_name != name) {
+		glyph_cache->Clear();
+		tint_cache->Clear();
+
+		cache_name = name;
+		cache_size = size;
+		cache_bold = bold;
+		cache_italic = italic;
+	}
+}
+
+Bitmap const& Font::CachedGlyph(unsigned code, Rect& rect) {
+	CheckGlyphCache();
+
+	GlyphCache::key_type const key(code, 0);
+	GlyphCache::Entry const* entry = glyph_cache->Find(key);
+
+	if (!entry) {
+		BitmapRef const glyph = Glyph(code);
+		int const width = glyph->width();
+		int const height = glyph->height();
+
+		entry = &glyph_cache->Insert(key, width, height);
+		Bitmap& page = *glyph_cache->pages[entry->page];
+		int const page_pitch = page.pitch();
+		uint8_t* dst = reinterpret_cast<uint8_t*>(page.pixels())
+			+ entry->rect.y * page_pitch + entry->rect.x;
+
+		if (width > 0 && height > 0) {
+			if (glyph->bpp() == 1) {
+				// Font glyphs are 8-bit already
+				uint8_t const* src = reinterpret_cast<uint8_t const*>(glyph->pixels());
+				for (int row = 0; row < height; ++row) {
+					memcpy(dst + row * page_pitch, src + row * glyph->pitch(), width);
+				}
+			} else {
+				// Keep only the alpha channel
+				DynamicFormat format(32,8,24,8,16,8,8,8,0,PF::Alpha);
+				std::vector<uint32_t> pixels(width * height);
+				Bitmap bmp(reinterpret_cast<void*>(&pixels.front()), width, height, width * 4, format);
+				bmp.Blit(0, 0, *glyph, glyph->GetRect(), Opacity::opaque);
+
+				for (int row = 0; row < height; ++row) {
+					for (int col = 0; col < width; ++col) {
+						dst[row * page_pitch + col] = pixels[row * width + col] & 0xFF;
+					}
+				}
+			}
+		}
+	}
+
+	rect = entry->rect;
+	return *glyph_cache->pages[entry->page];
+}
+
 bool FTFont::check_face() {
 	if(!library_) {
 		if(library_checker_.expired()) {
@@ -301,24 +440,54 @@ bool FTFont::check_face() {
 }
 
 void Font::Render(Bitmap& bmp, int const x, int const y, Bitmap const& sys, int color, unsigned code) {
-	if(color != ColorShadow) {
-		BitmapRef system = Cache::System();
-		Render(bmp, x + 1, y + 1, system->GetShadowColor(), code);
+	CheckGlyphCache();
+
+	// Tinted glyphs are only valid for the system graphic they were made from
+	if (tint_system != sys.GetId()) {
+		tint_cache->Clear();
+		tint_system = sys.GetId();
 	}
 
-	BitmapRef bm = Glyph(code);
+	// Key of the drop shadow, which uses the solid shadow color
+	int const shadow_key = ColorShadow - 1;
+
+	Bitmap const* mask = NULL;
+	Rect mask_rect;
+
+	// Draws the drop shadow first, then the glyph itself
+	for (int pass = color != ColorShadow? 0 : 1; pass < 2; ++pass) {
+		GlyphCache::key_type const key(code, pass == 0? shadow_key : color);
+		GlyphCache::Entry const* entry = tint_cache->Find(key);
+
+		if (!entry) {
+			if (!mask) {
+				mask = &CachedGlyph(code, mask_rect);
+			}
+
+			entry = &tint_cache->Insert(key, mask_rect.width, mask_rect.height);
+			Bitmap& page = *tint_cache->pages[entry->page];
 
-	unsigned const
-		src_x = color == ColorShadow? 16 : color % 10 * 16 + 2,
-		src_y = color == ColorShadow? 32 : color / 10 * 16 + 48 + 16 - bm->height();
+			if (pass == 0) {
+				page.MaskedBlit(entry->rect, *mask, mask_rect.x, mask_rect.y, sys.GetShadowColor());
+			} else {
+				unsigned const
+					src_x = color == ColorShadow? 16 : color % 10 * 16 + 2,
+					src_y = color == ColorShadow? 32 : color / 10 * 16 + 48 + 16 - mask_rect.height;
 
-	bmp.MaskedBlit(Rect(x, y, bm->width(), bm->height()), *bm, 0, 0, sys, src_x, src_y);
+				page.MaskedBlit(entry->rect, *mask, mask_rect.x, mask_rect.y, sys, src_x, src_y);
+			}
+		}
+
+		int const offset = pass == 0? 1 : 0;
+		bmp.Blit(x + offset, y + offset, *tint_cache->pages[entry->page], entry->rect, Opacity::opaque);
+	}
 }
 
 void Font::Render(Bitmap& bmp, int x, int y, Color const& color, unsigned code) {
-	BitmapRef bm = Glyph(code);
+	Rect rect;
+	Bitmap const& mask = CachedGlyph(code, rect);
 
-	bmp.MaskedBlit(Rect(x, y, bm->width(), bm->height()), *bm, 0, 0, color);
+	bmp.MaskedBlit(Rect(x, y, rect.width, rect.height), mask, rect.x, rect.y, color);
 }
 
 ExFont::ExFont() : Font("exfont", 12, false, false) {
@@ -329,7 +498,7 @@ FontRef Font::exfont = EASYRPG_MAKE_SHARED<ExFont>();
 BitmapRef ExFont::Glyph(unsigned code) {
 	BitmapRef exfont = Cache::Exfont();
 	Rect const rect((code % 13) * 12, (code / 13) * 12, 12, 12);
-	return Bitmap::Create(*exfont, rect, true);
+	return Bitmap::CreateView(exfont, rect);
 }
 
 Rect ExFont::GetSize(std::string const& /* txt */) const {
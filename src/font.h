@@ -36,6 +36,17 @@ class Font {
 
 	virtual BitmapRef Glyph(unsigned code) = 0;
 
+	/**
+	 * Gets a glyph from the glyph atlas.
+	 * The glyph is rasterized with Glyph into a shared 8-bit
+	 * alpha page the first time it is requested.
+	 *
+	 * @param code code point.
+	 * @param rect receives the glyph rect inside the page.
+	 * @return atlas page holding the glyph.
+	 */
+	Bitmap const& CachedGlyph(unsigned code, Rect& rect);
+
 	void Render(Bitmap& bmp, int x, int y, Bitmap const& sys, int color, unsigned glyph);
 	void Render(Bitmap& bmp, int x, int y, Color const& color, unsigned glyph);
 
@@ -65,6 +76,24 @@ class Font {
 	size_t pixel_size() const { return size * 96 / 72; }
  protected:
 	Font(const std::string& name, int size, bool bold, bool italic);
+
+ private:
+	struct GlyphCache;
+
+	/** Alpha glyphs, keyed by code point. */
+	EASYRPG_SHARED_PTR<GlyphCache> glyph_cache;
+	/** Glyphs tinted with a system graphic color, keyed by code point and color. */
+	EASYRPG_SHARED_PTR<GlyphCache> tint_cache;
+	/** Identifier of the system graphic the tinted glyphs were made from. */
+	unsigned tint_system;
+
+	/** Font properties the cached glyphs were rendered with. */
+	std::string cache_name;
+	unsigned cache_size;
+	bool cache_bold;
+	bool cache_italic;
+
+	void CheckGlyphCache();
 };
 
 #endif
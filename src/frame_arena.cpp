@@ -0,0 +1,124 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+#include "frame_arena.h"
+#include "output.h"
+
+namespace {
+	struct Block {
+		char* memory;
+		char* data;
+		size_t size;
+		size_t used;
+	};
+
+	std::vector<Block> blocks;
+	size_t used_bytes = 0;
+	size_t high_water = 0;
+	size_t capacity = 0;
+	unsigned block_count = 0;
+
+	// Busiest frames of the current and the previous window, the arena
+	// is sized by them so a single large frame is forgotten again
+	size_t window_peak = 0;
+	size_t previous_peak = 0;
+	unsigned window_frames = 0;
+
+	// Smallest block requested from the system
+	const size_t block_size = 256 * 1024;
+	const size_t alignment = 16;
+	// Frames per window, about 5 seconds
+	const unsigned window_length = 300;
+
+	void AddBlock(size_t size) {
+		Block block;
+		block.memory = static_cast<char*>(malloc(size + alignment - 1));
+		if (block.memory == NULL) {
+			Output::Error("Couldn't allocate %lu bytes of frame memory.", (unsigned long) size);
+		}
+		block.data = reinterpret_cast<char*>(
+			(reinterpret_cast<size_t>(block.memory) + alignment - 1) & ~(alignment - 1));
+		block.size = size;
+		block.used = 0;
+		blocks.push_back(block);
+
+		capacity += size;
+		++block_count;
+	}
+}
+
+void* FrameArena::Allocate(size_t bytes) {
+	bytes = (bytes + alignment - 1) & ~(alignment - 1);
+
+	if (blocks.empty() || blocks.back().used + bytes > blocks.back().size) {
+		AddBlock(std::max(bytes, block_size));
+	}
+
+	Block& block = blocks.back();
+	void* result = block.data + block.used;
+	block.used += bytes;
+
+	used_bytes += bytes;
+	high_water = std::max(high_water, used_bytes);
+
+	return result;
+}
+
+void FrameArena::Reset() {
+	window_peak = std::max(window_peak, used_bytes);
+	if (++window_frames == window_length) {
+		previous_peak = window_peak;
+		window_peak = 0;
+		window_frames = 0;
+	}
+	used_bytes = 0;
+
+	size_t const peak = std::max(window_peak, previous_peak);
+	size_t const wanted = std::max((peak + block_size - 1) / block_size * block_size, block_size);
+
+	if (blocks.size() > 1 || (!blocks.empty() && blocks.back().size > 2 * wanted)) {
+		// Replace the blocks with a single one large enough for the
+		// recent busiest frame
+		Clear();
+		AddBlock(wanted);
+	} else if (!blocks.empty()) {
+		blocks.back().used = 0;
+	}
+}
+
+void FrameArena::Clear() {
+	for (std::vector<Block>::iterator it = blocks.begin(); it != blocks.end(); ++it) {
+		free(it->memory);
+	}
+	blocks.clear();
+	capacity = 0;
+	used_bytes = 0;
+}
+
+FrameArena::Stats FrameArena::GetStats() {
+	Stats stats;
+	stats.used = used_bytes;
+	stats.high_water = high_water;
+	stats.capacity = capacity;
+	stats.blocks = block_count;
+	return stats;
+}
@@ -0,0 +1,70 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FRAME_ARENA_H_
+#define _FRAME_ARENA_H_
+
+// Headers
+#include <cstddef>
+
+/**
+ * FrameArena namespace.
+ * Bump allocator for pixel storage that only lives during one frame.
+ */
+namespace FrameArena {
+	/**
+	 * Allocates transient storage.
+	 * The storage stays valid until the next Reset and must not be freed.
+	 *
+	 * @param bytes size of the storage.
+	 * @return storage, aligned to 16 bytes.
+	 */
+	void* Allocate(size_t bytes);
+
+	/**
+	 * Invalidates all allocations.
+	 * Called by Graphics after every drawn frame. Memory the busiest
+	 * frames of the last seconds didn't need is given back.
+	 */
+	void Reset();
+
+	/**
+	 * Frees the memory held by the arena.
+	 */
+	void Clear();
+
+	/** Arena usage statistics. */
+	struct Stats {
+		/** Bytes allocated since the last Reset. */
+		size_t used;
+		/** Most bytes used during one frame. */
+		size_t high_water;
+		/** Bytes currently reserved from the system. */
+		size_t capacity;
+		/** Blocks requested from the system so far. */
+		unsigned blocks;
+	};
+
+	/**
+	 * Gets the arena usage statistics.
+	 *
+	 * @return statistics.
+	 */
+	Stats GetStats();
+}
+
+#endif
@@ -74,7 +74,11 @@ int Game_Event::GetX() const {
 }
 
 void Game_Event::SetX(int new_x) {
+	int const old_x = data.position_x;
 	data.position_x = new_x;
+	if (old_x != new_x) {
+		Game_Map::UpdateEventPosition(this, old_x, data.position_y);
+	}
 }
 
 int Game_Event::GetY() const {
@@ -82,7 +86,11 @@ int Game_Event::GetY() const {
 }
 
 void Game_Event::SetY(int new_y) {
+	int const old_y = data.position_y;
 	data.position_y = new_y;
+	if (old_y != new_y) {
+		Game_Map::UpdateEventPosition(this, data.position_x, old_y);
+	}
 }
 
 int Game_Event::GetMapId() const {
@@ -52,10 +52,15 @@
 std::vector<Game_Character*> Game_Interpreter_Map::pending;
 
 Game_Interpreter_Map::Game_Interpreter_Map(int depth, bool main_flag) :
-	Game_Interpreter(depth, main_flag) {
+	Game_Interpreter(depth, main_flag),
+	request(NULL) {
 }
 
 Game_Interpreter_Map::~Game_Interpreter_Map() {
+	if (request) {
+		request->Unbind(request_id);
+	}
+
 	std::vector<Game_Character*>::iterator it;
 	std::vector<Game_Character*> toerase;
 	for (it = pending.begin(); it != pending.end(); ++it) {
@@ -901,8 +906,11 @@ void Game_Interpreter_Map::OnChangeSystemGraphicReady(FileRequestResult* result)
 }
 
 bool Game_Interpreter_Map::CommandChangeSystemGraphics(RPG::EventCommand const& com) { // code 10680
-	FileRequestAsync* request = AsyncHandler::RequestFile("System", com.string);
-	request->Bind(&Game_Interpreter_Map::OnChangeSystemGraphicReady, this);
+	if (request) {
+		request->Unbind(request_id);
+	}
+	request = AsyncHandler::RequestFile("System", com.string);
+	request_id = request->Bind(&Game_Interpreter_Map::OnChangeSystemGraphicReady, this);
 	request->SetImportantFile(true);
 	request->Start();
 
@@ -29,6 +29,7 @@
 
 class Game_Event;
 class Game_CommonEvent;
+class FileRequestAsync;
 
 /**
  * Game_Interpreter_Map class
@@ -139,6 +140,9 @@ private:
 	RPG::MoveCommand DecodeMove(std::vector<int>::const_iterator& it);
 
 	static std::vector<Game_Character*> pending;
+
+	FileRequestAsync* request;
+	int request_id;
 };
 
 #endif
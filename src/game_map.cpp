@@ -16,12 +16,16 @@
  */
 
 // Headers
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <iomanip>
+#include <set>
 #include <sstream>
 
 #include "async_handler.h"
+#include "cache.h"
+#include "command_codes.h"
 #include "system.h"
 #include "game_map.h"
 #include "game_interpreter_map.h"
@@ -59,6 +63,11 @@ namespace {
 	tEventHash events;
 	tCommonEventHash common_events;
 
+	// Events by tile ordered by ID like events, the last bucket holds
+	// the events outside of the map
+	typedef std::vector<Game_Event*> event_bucket;
+	std::vector<event_bucket> event_grid;
+
 	std::auto_ptr<RPG::Map> map;
 	int scroll_direction;
 	int scroll_rest;
@@ -72,6 +81,173 @@ namespace {
 	bool pan_wait;
 	int pan_speed;
 	bool ready;
+
+	typedef std::set<std::pair<std::string, std::string> > prefetch_files;
+
+	/**
+	 * Estimates the memory of a decoded image before it is decoded,
+	 * sized for the usual sheets of the RTP.
+	 */
+	size_t EstimatePrefetchBytes(const std::string& directory) {
+		if (directory == "CharSet") {
+			return 288 * 256 * 4;
+		} else if (directory == "FaceSet") {
+			return 192 * 192 * 4;
+		} else if (directory == "Battle") {
+			return 480 * 480 * 4;
+		} else if (directory == "Battle2") {
+			return 640 * 640 * 4;
+		}
+		return 320 * 240 * 4;
+	}
+
+	void AddPrefetch(prefetch_files& files, const char* directory, const std::string& name) {
+		// (OFF) and its Polish translation mean play nothing
+		if (!name.empty() && name != "(OFF)" && name != "(Brak)") {
+			files.insert(std::make_pair(std::string(directory), name));
+		}
+	}
+
+	void AddPrefetchAnimation(prefetch_files& files, int animation_id) {
+		if (animation_id <= 0 || animation_id > (int)Data::animations.size()) {
+			return;
+		}
+
+		// Same lookup as BattleAnimation
+		const std::string& name = Data::animations[animation_id - 1].animation_name;
+#ifdef EMSCRIPTEN
+		AddPrefetch(files, "Battle", name);
+#else
+		if (!FileFinder::FindImage("Battle", name).empty()) {
+			AddPrefetch(files, "Battle", name);
+		} else if (!FileFinder::FindImage("Battle2", name).empty()) {
+			AddPrefetch(files, "Battle2", name);
+		}
+#endif
+	}
+
+	void CollectPrefetch(prefetch_files& files, bool picture_transparent,
+						 const std::vector<RPG::EventCommand>& commands) {
+		std::vector<RPG::EventCommand>::const_iterator it;
+		for (it = commands.begin(); it != commands.end(); ++it) {
+			const RPG::EventCommand& com = *it;
+
+			switch (com.code) {
+			case Cmd::ChangeFaceGraphic:
+			case Cmd::ChangeActorFace:
+				AddPrefetch(files, "FaceSet", com.string);
+				break;
+			case Cmd::ChangeSpriteAssociation:
+				AddPrefetch(files, "CharSet", com.string);
+				break;
+			case Cmd::ShowPicture:
+				// Decoded with the default transparency, others would be decoded twice
+				if (com.parameters.size() > 7 && (com.parameters[7] > 0) == picture_transparent) {
+					AddPrefetch(files, "Picture", com.string);
+				}
+				break;
+			case Cmd::ShowBattleAnimation:
+				if (!com.parameters.empty()) {
+					AddPrefetchAnimation(files, com.parameters[0]);
+				}
+				break;
+#ifdef EMSCRIPTEN
+			// Only downloads gain from it, elsewhere audio is read when played
+			case Cmd::PlayBGM:
+				AddPrefetch(files, "Music", com.string);
+				break;
+			case Cmd::PlaySound:
+				AddPrefetch(files, "Sound", com.string);
+				break;
+#endif
+			default:
+				break;
+			}
+		}
+	}
+
+	/**
+	 * Requests the graphics and sounds the events of the map and the
+	 * common events use, so a cutscene doesn't wait for them.
+	 * The cache holds the decoded images until they are loaded.
+	 */
+	void PrefetchAssets() {
+		// Loading everything right away would only slow down the map change
+		if (!AsyncHandler::LoadsInBackground()) {
+			return;
+		}
+
+		bool picture_transparent = true;
+		uint32_t picture_flags;
+		Cache::GetImageParams("Picture", picture_transparent, picture_flags);
+
+		prefetch_files files;
+
+		std::vector<RPG::Event>::const_iterator ev;
+		for (ev = map->events.begin(); ev != map->events.end(); ++ev) {
+			std::vector<RPG::EventPage>::const_iterator page;
+			for (page = ev->pages.begin(); page != ev->pages.end(); ++page) {
+				AddPrefetch(files, "CharSet", page->character_name);
+				CollectPrefetch(files, picture_transparent, page->event_commands);
+			}
+		}
+
+		std::vector<RPG::CommonEvent>::const_iterator ce;
+		for (ce = Data::commonevents.begin(); ce != Data::commonevents.end(); ++ce) {
+			CollectPrefetch(files, picture_transparent, ce->event_commands);
+		}
+
+		// Images are only requested while their estimated size fits into
+		// what the cache holds, later ones would drop the first ones.
+		// Files requested before are left to the cache, loading them
+		// again on every map change would stall the map change instead.
+		size_t budget = Cache::GetPreloadRoom();
+		for (prefetch_files::const_iterator it = files.begin(); it != files.end(); ++it) {
+			FileRequestAsync* request = AsyncHandler::RequestFile(it->first, it->second);
+			if (request->IsReady()) {
+				continue;
+			}
+			if (it->first != "Music" && it->first != "Sound") {
+				size_t const bytes = EstimatePrefetchBytes(it->first);
+				if (bytes > budget) {
+					continue;
+				}
+				budget -= bytes;
+			}
+			request->Prefetch();
+		}
+	}
+
+	event_bucket& GetEventBucket(int x, int y) {
+		static event_bucket no_events;
+		if (event_grid.empty()) {
+			return no_events;
+		}
+
+		return Game_Map::IsValid(x, y) ?
+			event_grid[x + y * Game_Map::GetWidth()] : event_grid.back();
+	}
+
+	bool EventIdLess(const Game_Event* a, const Game_Event* b) {
+		return a->GetId() < b->GetId();
+	}
+
+	void AddToEventGrid(Game_Event* ev) {
+		event_bucket& bucket = GetEventBucket(ev->GetX(), ev->GetY());
+		bucket.insert(std::upper_bound(bucket.begin(), bucket.end(), ev, EventIdLess), ev);
+	}
+
+	/**
+	 * Sorts the events of the map into the tile buckets. Moves are
+	 * only tracked afterwards, so this runs once all events exist.
+	 */
+	void BuildEventGrid() {
+		event_grid.assign(Game_Map::GetWidth() * Game_Map::GetHeight() + 1, event_bucket());
+
+		for (tEventHash::const_iterator i = events.begin(); i != events.end(); ++i) {
+			AddToEventGrid(i->second.get());
+		}
+	}
 }
 
 void Game_Map::Init() {
@@ -108,6 +284,7 @@ void Game_Map::Init() {
 
 void Game_Map::Dispose() {
 	events.clear();
+	event_grid.clear();
 
 	if (Main_Data::game_screen) {
 		Main_Data::game_screen->Reset();
@@ -129,6 +306,7 @@ void Game_Map::Setup(int _id) {
 	for (size_t i = 0; i < map->events.size(); ++i) {
 		events.insert(std::make_pair(map->events[i].ID, EASYRPG_MAKE_SHARED<Game_Event>(location.map_id, map->events[i])));
 	}
+	BuildEventGrid();
 
 	location.pan_finish_x = 0;
 	location.pan_finish_y = 0;
@@ -154,6 +332,7 @@ void Game_Map::SetupFromSave() {
 
 		events.insert(std::make_pair(map->events[i].ID, evnt));
 	}
+	BuildEventGrid();
 
 	for (size_t i = 0; i < Data::commonevents.size(); ++i) {
 		EASYRPG_SHARED_PTR<Game_CommonEvent> evnt;
@@ -241,6 +420,8 @@ void Game_Map::SetupCommon(int _id) {
 	location.map_save_count = map->save_count;
 
 	ResetEncounterSteps();
+
+	PrefetchAssets();
 }
 
 void Game_Map::PrepareSave() {
@@ -508,15 +689,16 @@ bool Game_Map::IsLandable(int x, int y, const Game_Character *self_event) {
 	int bit = Passable::Down | Passable::Right | Passable::Left | Passable::Up;
 
 	if (self_event) {
-		for (tEventHash::iterator i = events.begin(); i != events.end(); ++i) {
-			Game_Event* evnt = i->second.get();
+		event_bucket const& bucket = GetEventBucket(x, y);
+		for (event_bucket::const_iterator i = bucket.begin(); i != bucket.end(); ++i) {
+			Game_Event* evnt = *i;
 			if (evnt != self_event && evnt->IsInPosition(x, y)) {
 				if (!evnt->GetThrough()) {
 					if (evnt->GetLayer() == RPG::EventPage::Layers_same) {
 						return false;
 					} else if (evnt->GetTileId() >= 0 && evnt->GetLayer() == RPG::EventPage::Layers_below) {
 						// Event layer Chipset Tile
-						tile_id = i->second->GetTileId();
+						tile_id = evnt->GetTileId();
 						return !!(passages_down[tile_id] & bit);
 					}
 				}
@@ -604,16 +786,33 @@ bool Game_Map::AirshipLandOk(int const x, int const y) {
 void Game_Map::GetEventsXY(std::vector<Game_Event*>& events, int x, int y) {
 	std::vector<Game_Event*> result;
 
-	tEventHash::const_iterator i;
-	for (i = Game_Map::GetEvents().begin(); i != Game_Map::GetEvents().end(); ++i) {
-		if (i->second->IsInPosition(x, y) && i->second->GetActive()) {
-			result.push_back(i->second.get());
+	// Events outside of the map share a bucket
+	event_bucket const& bucket = GetEventBucket(x, y);
+	for (event_bucket::const_iterator i = bucket.begin(); i != bucket.end(); ++i) {
+		if ((*i)->IsInPosition(x, y) && (*i)->GetActive()) {
+			result.push_back(*i);
 		}
 	}
 
 	events.swap(result);
 }
 
+void Game_Map::UpdateEventPosition(Game_Event* ev, int old_x, int old_y) {
+	if (event_grid.empty()) {
+		return;
+	}
+
+	event_bucket& bucket = GetEventBucket(old_x, old_y);
+	event_bucket::iterator const it = std::find(bucket.begin(), bucket.end(), ev);
+	if (it == bucket.end()) {
+		// Not in the grid yet, BuildEventGrid adds it
+		return;
+	}
+	bucket.erase(it);
+
+	AddToEventGrid(ev);
+}
+
 bool Game_Map::LoopHorizontal() {
 	return map->scroll_type == RPG::Map::ScrollType_horizontal || map->scroll_type == RPG::Map::ScrollType_both;
 }
@@ -647,10 +846,10 @@ int Game_Map::YwithDirection(int y, int direction) {
 }
 
 int Game_Map::CheckEvent(int x, int y) {
-	tEventHash::iterator i;
-	for (i = events.begin(); i != events.end(); ++i) {
-		if (i->second->IsInPosition(x, y)) {
-			return i->second->GetId();
+	event_bucket const& bucket = GetEventBucket(x, y);
+	for (event_bucket::const_iterator i = bucket.begin(); i != bucket.end(); ++i) {
+		if ((*i)->IsInPosition(x, y)) {
+			return (*i)->GetId();
 		}
 	}
 
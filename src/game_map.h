@@ -466,8 +466,25 @@ namespace Game_Map {
 	 */
 	tCommonEventHash& GetCommonEvents();
 
+	/**
+	 * Gets the active events on a tile.
+	 *
+	 * @param events receives the events, ordered by ID.
+	 * @param x tile x.
+	 * @param y tile y.
+	 */
 	void GetEventsXY(std::vector<Game_Event*>& events, int x, int y);
 
+	/**
+	 * Moves an event to the bucket of its new tile in the event index.
+	 * Called by Game_Event whenever its position changes.
+	 *
+	 * @param ev event that moved.
+	 * @param old_x tile x before the move.
+	 * @param old_y tile y before the move.
+	 */
+	void UpdateEventPosition(Game_Event* ev, int old_x, int old_y);
+
 	bool LoopHorizontal();
 	bool LoopVertical();
 
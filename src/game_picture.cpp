@@ -40,6 +40,9 @@ Game_Picture::Game_Picture(int ID) :
 }
 
 Game_Picture::~Game_Picture() {
+	if (request) {
+		request->Unbind(request_id);
+	}
 	data.name = "";
 }
 
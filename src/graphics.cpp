@@ -22,12 +22,17 @@
 #include <map>
 
 #include "graphics.h"
+#include "band_pool.h"
 #include "bitmap.h"
 #include "cache.h"
 #include "baseui.h"
 #include "drawable.h"
+#include "frame_arena.h"
+#include "image_cache.h"
 #include "util_macro.h"
 #include "player.h"
+#include "output.h"
+#include "text.h"
 
 namespace Graphics {
 	bool fps_on_screen;
@@ -108,6 +113,31 @@ void Graphics::Quit() {
 	frozen_screen.reset();
 	black_screen.reset();
 
+	Text::CacheStats const text_stats = Text::GetCacheStats();
+	Output::Debug("Text run cache: %u hits, %u misses", text_stats.hits, text_stats.misses);
+	Text::ClearCache();
+
+	Bitmap::MaskStats const mask_stats = Bitmap::GetMaskStats();
+	Output::Debug("Opacity mask pool: %u hits, %u allocations", mask_stats.hits, mask_stats.allocations);
+	Bitmap::ClearMaskPool();
+
+	FrameArena::Stats const arena_stats = FrameArena::GetStats();
+	Output::Debug("Frame arena: %lu bytes high-water mark, %u blocks allocated",
+				  (unsigned long) arena_stats.high_water, arena_stats.blocks);
+	FrameArena::Clear();
+
+	BandPool::Quit();
+
+	if (ImageCache::IsEnabled()) {
+		ImageCache::Stats const image_stats = ImageCache::GetStats();
+		Output::Debug("Image cache: %u hits, %u misses, %u stored",
+					  image_stats.hits, image_stats.misses, image_stats.stores);
+	}
+
+	Cache::Stats const cache_stats = Cache::GetStats();
+	Output::Debug("Bitmap cache: %u hits, %u misses, %u evictions, %lu bytes retained",
+				  cache_stats.hits, cache_stats.misses, cache_stats.evictions,
+				  (unsigned long) cache_stats.retained_bytes);
 	Cache::Clear();
 }
 
@@ -163,10 +193,12 @@ void Graphics::DrawFrame() {
 		DrawOverlay();
 
 		DisplayUi->UpdateDisplay();
+		FrameArena::Reset();
 		return;
 	}
 
 	if (screen_erased) {
+		FrameArena::Reset();
 		return;
 	}
 
@@ -193,6 +225,9 @@ void Graphics::DrawFrame() {
 	DrawOverlay();
 
 	DisplayUi->UpdateDisplay();
+
+	// Transient pixel storage only lives until the frame is drawn
+	FrameArena::Reset();
 }
 
 void Graphics::DrawOverlay() {
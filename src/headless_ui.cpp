@@ -0,0 +1,215 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include "headless_ui.h"
+#include "bitmap.h"
+#include "keys.h"
+#include "output.h"
+#include "player.h"
+
+namespace {
+	/** Script names of the keyboard keys, in Input::Keys order. */
+	const char* const key_names[] = {
+		"NONE", "BACKSPACE", "TAB", "CLEAR", "RETURN", "PAUSE", "ESCAPE",
+		"SPACE", "PGUP", "PGDN", "ENDS", "HOME", "LEFT", "UP", "RIGHT", "DOWN",
+		"SNAPSHOT", "INSERT", "DEL", "SHIFT", "LSHIFT", "RSHIFT", "CTRL",
+		"LCTRL", "RCTRL", "ALT", "LALT", "RALT",
+		"N0", "N1", "N2", "N3", "N4", "N5", "N6", "N7", "N8", "N9",
+		"A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K", "L", "M",
+		"N", "O", "P", "Q", "R", "S", "T", "U", "V", "W", "X", "Y", "Z",
+		"LOS", "ROS", "MENU",
+		"KP0", "KP1", "KP2", "KP3", "KP4", "KP5", "KP6", "KP7", "KP8", "KP9",
+		"MULTIPLY", "ADD", "SUBTRACT", "PERIOD", "DIVIDE",
+		"F1", "F2", "F3", "F4", "F5", "F6", "F7", "F8", "F9", "F10", "F11", "F12",
+		"CAPS_LOCK", "NUM_LOCK", "SCROLL_LOCK", "AC_BACK", "SELECT"
+	};
+
+	/** Marks a script entry that ends the game. */
+	const int exit_key = -1;
+
+	int KeyFromName(const std::string& name) {
+		if (name == "EXIT")
+			return exit_key;
+
+		if (!name.empty() && isdigit(name[0])) {
+			int key = atoi(name.c_str());
+			return key < Input::Keys::KEYS_COUNT ? key : Input::Keys::NONE;
+		}
+
+		for (int i = 0; i <= Input::Keys::SELECT; ++i) {
+			if (name == key_names[i])
+				return i;
+		}
+		return Input::Keys::NONE;
+	}
+}
+
+HeadlessUi::HeadlessUi(long width, long height) :
+	BaseUi(),
+	script_pos(0),
+	frame(0),
+	frame_limit(0),
+	ticks(0),
+	start_clock(std::clock()) {
+
+	current_display_mode.width = width;
+	current_display_mode.height = height;
+	current_display_mode.bpp = 32;
+	current_display_mode.effective = true;
+
+	// Nothing is displayed, any format pixman supports natively will do
+	const DynamicFormat format(
+		32,
+		0x00FF0000,
+		0x0000FF00,
+		0x000000FF,
+		0xFF000000,
+		PF::NoAlpha);
+	Bitmap::SetFormat(Bitmap::ChooseFormat(format));
+
+	main_surface = Bitmap::Create(width, height, false);
+}
+
+HeadlessUi::~HeadlessUi() {
+	double seconds = (double)(std::clock() - start_clock) / CLOCKS_PER_SEC;
+	Output::Debug("Headless: %d frames in %.2fs CPU time (%.1f fps)",
+		frame, seconds, seconds > 0.0 ? frame / seconds : 0.0);
+}
+
+bool HeadlessUi::LoadScript(const std::string& filename) {
+	std::ifstream file(filename.c_str());
+	if (!file) {
+		Output::Warning("Headless: Cannot open input script %s", filename.c_str());
+		return false;
+	}
+
+	std::string line;
+	int line_number = 0;
+	while (std::getline(file, line)) {
+		++line_number;
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream stream(line);
+		std::string name;
+		InputEvent event;
+		int state = 1;
+		if (!(stream >> event.frame >> name)) {
+			Output::Warning("Headless: Malformed script line %d", line_number);
+			continue;
+		}
+		stream >> state;
+
+		event.key = KeyFromName(name);
+		event.pressed = state != 0;
+		if (event.key == Input::Keys::NONE) {
+			Output::Warning("Headless: Unknown key %s in script line %d", name.c_str(), line_number);
+			continue;
+		}
+		script.push_back(event);
+	}
+
+	std::stable_sort(script.begin(), script.end());
+	script_pos = 0;
+
+	return true;
+}
+
+void HeadlessUi::SetFrameLimit(int frames) {
+	frame_limit = frames;
+}
+
+int HeadlessUi::GetFrameCount() const {
+	return frame;
+}
+
+void HeadlessUi::BeginDisplayModeChange() {
+}
+
+void HeadlessUi::EndDisplayModeChange() {
+}
+
+void HeadlessUi::Resize(long /*width*/, long /*height*/) {
+}
+
+void HeadlessUi::ToggleFullscreen() {
+}
+
+void HeadlessUi::ToggleZoom() {
+}
+
+void HeadlessUi::ProcessEvents() {
+	while (script_pos < script.size() && script[script_pos].frame <= frame) {
+		const InputEvent& event = script[script_pos++];
+		if (event.key == exit_key) {
+			Player::exit_flag = true;
+		} else {
+			keys[event.key] = event.pressed;
+		}
+	}
+
+	++frame;
+
+	if (frame_limit > 0 && frame >= frame_limit) {
+		Player::exit_flag = true;
+	}
+}
+
+void HeadlessUi::UpdateDisplay() {
+	// The frame stays in main_surface
+}
+
+void HeadlessUi::BeginScreenCapture() {
+	CleanDisplay();
+}
+
+BitmapRef HeadlessUi::EndScreenCapture() {
+	return Bitmap::Create(*main_surface, main_surface->GetRect());
+}
+
+void HeadlessUi::SetTitle(const std::string& /*title*/) {
+}
+
+bool HeadlessUi::ShowCursor(bool flag) {
+	bool temp_flag = cursor_visible;
+	cursor_visible = flag;
+	return temp_flag;
+}
+
+bool HeadlessUi::IsFullscreen() {
+	return false;
+}
+
+uint32_t HeadlessUi::GetTicks() const {
+	return ticks;
+}
+
+void HeadlessUi::Sleep(uint32_t time_milli) {
+	// Never blocks: Player::Update sleeps until the next frame is due,
+	// which moves the virtual clock exactly one frame ahead.
+	ticks += time_milli;
+}
+
+AudioInterface& HeadlessUi::GetAudio() {
+	return audio_;
+}
@@ -0,0 +1,139 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HEADLESS_UI_H_
+#define _HEADLESS_UI_H_
+
+// Headers
+#include <ctime>
+#include <string>
+#include <vector>
+#include "audio.h"
+#include "baseui.h"
+#include "system.h"
+
+/**
+ * HeadlessUi class.
+ *
+ * Display without a window. Frames are rendered into an in-memory bitmap,
+ * input is read from a script and time is a virtual clock that only moves
+ * when the player sleeps, so every Player::Update advances it by exactly
+ * one frame and a game runs as fast as the CPU allows.
+ */
+class HeadlessUi : public BaseUi {
+public:
+	/**
+	 * Constructor.
+	 *
+	 * @param width display width.
+	 * @param height display height.
+	 */
+	HeadlessUi(long width, long height);
+
+	/**
+	 * Destructor.
+	 */
+	~HeadlessUi();
+
+	/**
+	 * Loads an input script.
+	 *
+	 * Every line has the form "FRAME KEY STATE", where KEY is the name of
+	 * an Input::Keys value (e.g. RETURN, LEFT, Z) or its number and STATE
+	 * is 1 for pressed or 0 for released. "FRAME EXIT" ends the game.
+	 * Empty lines and lines starting with # are ignored.
+	 *
+	 * @param filename script file.
+	 * @return whether the script was loaded.
+	 */
+	bool LoadScript(const std::string& filename);
+
+	/**
+	 * Sets after how many frames the game is ended.
+	 *
+	 * @param frames frame count, 0 runs until the game exits by itself.
+	 */
+	void SetFrameLimit(int frames);
+
+	/**
+	 * Gets the number of frames processed so far.
+	 *
+	 * @return frame count.
+	 */
+	int GetFrameCount() const;
+
+	/**
+	 * Inherited from BaseUi.
+	 */
+	/** @{ */
+
+	void BeginDisplayModeChange();
+	void EndDisplayModeChange();
+	void Resize(long width, long height);
+	void ToggleFullscreen();
+	void ToggleZoom();
+	void UpdateDisplay();
+	void BeginScreenCapture();
+	BitmapRef EndScreenCapture();
+	void SetTitle(const std::string &title);
+	bool ShowCursor(bool flag);
+
+	void ProcessEvents();
+
+	bool IsFullscreen();
+
+	uint32_t GetTicks() const;
+	void Sleep(uint32_t time_milli);
+
+	AudioInterface& GetAudio();
+
+	/** @} */
+
+private:
+	/** Scripted key change. */
+	struct InputEvent {
+		int frame;
+		int key;
+		bool pressed;
+
+		bool operator<(const InputEvent& other) const {
+			return frame < other.frame;
+		}
+	};
+
+	/** Scripted input sorted by frame. */
+	std::vector<InputEvent> script;
+
+	/** Next script entry to apply. */
+	size_t script_pos;
+
+	/** Frames processed. */
+	int frame;
+
+	/** Frame after which the game is ended, 0 for none. */
+	int frame_limit;
+
+	/** Virtual clock in ms. */
+	uint32_t ticks;
+
+	/** CPU time at startup, for the closing report. */
+	std::clock_t start_clock;
+
+	EmptyAudio audio_;
+};
+
+#endif
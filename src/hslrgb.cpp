@@ -18,6 +18,7 @@
 // Headers
 #include "hslrgb.h"
 #include "util_macro.h"
+#include "bitmap_hslrgb.h"
 
 struct ColorHSL {
 	double h;
@@ -116,3 +117,47 @@ Color RGBAdjustHSL(Color col, double h, double s, double l) {
 	rgb.alpha = col.alpha;
 	return rgb;
 }
+
+HueRotation::HueRotation(double hue_) {
+	hue = (int) (hue_ / 60.0 * 0x100);
+	if (hue < 0)
+		hue += ((-hue + 0x5FF) / 0x600) * 0x600;
+	else if (hue > 0x600)
+		hue -= (hue / 0x600) * 0x600;
+
+	// Alpha 0 pixels are never looked up, so 0 is a free key
+	for (int i = 0; i < MEMO_SIZE; i++)
+		memo_key[i] = 0;
+}
+
+uint32_t HueRotation::Rotate(uint32_t pixel) {
+	uint32_t key = pixel;
+	int slot = ((key >> 8) ^ (key >> 18) ^ (key >> 26)) & (MEMO_SIZE - 1);
+	if (memo_key[slot] != key) {
+		uint8_t r = (pixel >> 24) & 0xFF;
+		uint8_t g = (pixel >> 16) & 0xFF;
+		uint8_t b = (pixel >> 8) & 0xFF;
+		RGB_adjust_HSL(r, g, b, hue);
+		memo_key[slot] = key;
+		memo_value[slot] = ((uint32_t) r << 24) | ((uint32_t) g << 16) | ((uint32_t) b << 8) | (pixel & 0xFF);
+	}
+	return memo_value[slot];
+}
+
+void HueRotation::Row(uint32_t* pixels, int count) {
+	uint32_t last_in = 0;
+	uint32_t last_out = 0;
+
+	for (int i = 0; i < count; i++) {
+		uint32_t pixel = pixels[i];
+		if ((pixel & 0xFF) == 0)
+			continue;
+
+		// Runs of the same color are common in sprites
+		if (pixel != last_in) {
+			last_in = pixel;
+			last_out = Rotate(pixel);
+		}
+		pixels[i] = last_out;
+	}
+}
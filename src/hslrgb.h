@@ -19,6 +19,7 @@
 #define _HSLRGB_H_
 
 // Headers
+#include "system.h"
 #include "color.h"
 
 /**
@@ -26,4 +27,37 @@
  */
 Color RGBAdjustHSL(Color col, double h, double s, double l);
 
+/**
+ * Hue rotation of r8g8b8a8 pixel rows (red in the most significant byte).
+ * Results are memoized per color, so the usual images with few colors
+ * only pay for the HSL conversion once per color.
+ */
+class HueRotation {
+public:
+	/**
+	 * Constructor.
+	 *
+	 * @param hue hue change in degrees.
+	 */
+	HueRotation(double hue);
+
+	/**
+	 * Rotates the hue of a row of pixels in place.
+	 * Fully transparent pixels are left unchanged.
+	 *
+	 * @param pixels first pixel of the row.
+	 * @param count number of pixels.
+	 */
+	void Row(uint32_t* pixels, int count);
+
+private:
+	enum { MEMO_SIZE = 1024 };
+
+	uint32_t Rotate(uint32_t pixel);
+
+	int hue;
+	uint32_t memo_key[MEMO_SIZE];
+	uint32_t memo_value[MEMO_SIZE];
+};
+
 #endif
@@ -24,7 +24,6 @@
 #include <cstring>
 #include <algorithm>
 #include <vector>
-#include "output.h"
 #include "image_bmp.h"
 
 static uint16_t get_2(const uint8_t *p)
@@ -57,7 +56,6 @@ void ImageBMP::ReadBMP(const uint8_t* data, unsigned len, bool transparent,
 	static const unsigned BITMAPFILEHEADER_SIZE = 14;
 
 	if (len < 64 || strncmp((char*) &data[0], "BM", 2) != 0) {
-		Output::Error("Not a valid BMP file.");
 		return;
 	}
 
@@ -91,30 +89,40 @@ void ImageBMP::ReadBMP(const uint8_t* data, unsigned len, bool transparent,
 
 	const int planes = (int) get_2(&data[BITMAPFILEHEADER_SIZE + 12]);
 	if (planes != 1) {
-		Output::Error("BMP planes is not 1.");
 		return;
 	}
 
 	const int depth = (int) get_2(&data[BITMAPFILEHEADER_SIZE + 14]);
 	if (depth != 8) {
-		Output::Error("BMP image is not 8-bit.");
 		return;
 	}
 
 	const int compression = get_4(&data[BITMAPFILEHEADER_SIZE + 16]);
 	static const int BI_RGB = 0;
 	if (compression != BI_RGB) {
-		Output::Error("BMP image is compressed.");
 		return;
 	}
 
-	int num_colors = std::min(256U, get_4(&data[BITMAPFILEHEADER_SIZE + 32]));
-	uint8_t (*palette)[4] = (uint8_t(*)[4]) &data[BITMAPFILEHEADER_SIZE +
-		get_4(&data[BITMAPFILEHEADER_SIZE + 0])];
+	if (width <= 0 || height <= 0 || bits_offset > len ||
+		(len - bits_offset) / (unsigned) width < (unsigned) height) {
+		return;
+	}
+
+	// The data may be read-only (asset packs are mapped), so the palette
+	// is copied. Unused entries are black.
+	const unsigned palette_offset = BITMAPFILEHEADER_SIZE + get_4(&data[BITMAPFILEHEADER_SIZE + 0]);
+	unsigned num_colors = std::min(256U, get_4(&data[BITMAPFILEHEADER_SIZE + 32]));
+	if (palette_offset > len) {
+		return;
+	}
+	num_colors = std::min(num_colors, (len - palette_offset) / 4);
+
+	uint8_t palette[256][4] = {};
+	memcpy(palette, &data[palette_offset], num_colors * 4);
 	const uint8_t* src_pixels = &data[bits_offset];
 
 	// Ensure no palette entry is an exact duplicate of #0
-	for (int i = 1; i < num_colors; i++) {
+	for (unsigned i = 1; i < num_colors; i++) {
 		if (palette[i][0] == palette[0][0] &&
 			palette[i][1] == palette[0][1] &&
 			palette[i][2] == palette[0][2]) {
@@ -143,12 +151,13 @@ void ImageBMP::ReadBMP(FILE* stream, bool transparent,
 	fseek(stream, 0, SEEK_END);
 	long size = ftell(stream);
 	fseek(stream, 0, SEEK_SET);
+	pixels = NULL;
+	if (size <= 0)
+		return;
 	std::vector<uint8_t> buffer(size);
 	long size_read = fread((void*) &buffer.front(), 1, size, stream);
-	if (size_read != size) {
-		Output::Error("Error reading BMP file.");
+	if (size_read != size)
 		return;
-	}
 	ReadBMP(&buffer.front(), (unsigned) size, transparent, width, height, pixels);
 }
 
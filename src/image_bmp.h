@@ -24,6 +24,7 @@
 #include <cstdio>
 
 namespace ImageBMP {
+	// pixels is NULL when the file is invalid.
 	void ReadBMP(const uint8_t* data, unsigned len, bool transparent, int& width, int& height, void*& pixels);
 	void ReadBMP(FILE* stream, bool transparent, int& width, int& height, void*& pixels);
 }
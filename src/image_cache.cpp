@@ -0,0 +1,275 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "image_cache.h"
+#include "filefinder.h"
+#include "output.h"
+#include "pixel_format.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#  define IMAGE_CACHE_MMAP
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
+namespace {
+	std::string directory;
+	ImageCache::Stats stats = { 0, 0, 0 };
+
+	const char magic[4] = { 'E', 'I', 'C', '1' };
+
+	/** Entry file layout, followed by the source path and the pixels. */
+	struct Header {
+		char magic[4];
+		uint32_t width;
+		uint32_t height;
+		uint32_t pitch;
+		uint32_t bits;
+		uint32_t masks[4];
+		uint32_t alpha_type;
+		uint32_t mtime_low;
+		uint32_t mtime_high;
+		uint32_t path_length;
+		uint32_t data_offset;
+	};
+
+	/** Memory holding a whole entry file. */
+	struct Mapping {
+		void* base;
+		size_t length;
+	};
+
+	uint32_t Hash(const void* data, size_t length, uint32_t hash) {
+		const uint8_t* p = (const uint8_t*) data;
+		for (size_t i = 0; i < length; ++i) {
+			hash ^= p[i];
+			hash *= 16777619U;
+		}
+		return hash;
+	}
+
+	void FillFormat(Header& header, const DynamicFormat& format) {
+		header.bits = format.bits;
+		header.masks[0] = format.r.mask;
+		header.masks[1] = format.g.mask;
+		header.masks[2] = format.b.mask;
+		header.masks[3] = format.a.mask;
+		header.alpha_type = format.alpha_type;
+	}
+
+	void FillTime(Header& header, std::time_t mtime) {
+		uint64_t t = (uint64_t) mtime;
+		header.mtime_low = (uint32_t) t;
+		header.mtime_high = (uint32_t) (t >> 32);
+	}
+
+	std::string EntryPath(const std::string& filename, const Header& key) {
+		uint32_t path_hash = Hash(filename.data(), filename.size(), 2166136261U);
+		uint32_t format_hash = Hash(&key.bits, sizeof(uint32_t) * 6, 2166136261U);
+
+		char name[32];
+		sprintf(name, "%08x%08x.img", path_hash, format_hash);
+		return FileFinder::MakePath(directory, name);
+	}
+
+	Mapping* Map(const std::string& path) {
+#ifdef IMAGE_CACHE_MMAP
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return NULL;
+
+		struct stat sb;
+		if (fstat(fd, &sb) != 0 || sb.st_size < (off_t) sizeof(Header)) {
+			close(fd);
+			return NULL;
+		}
+
+		// Private writable mapping: drawing on a cached bitmap copies
+		// the touched pages instead of changing the entry
+		void* base = mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (base == MAP_FAILED)
+			return NULL;
+
+		Mapping* mapping = new Mapping;
+		mapping->base = base;
+		mapping->length = sb.st_size;
+		return mapping;
+#else
+		FILE* stream = FileFinder::fopenUTF8(path, "rb");
+		if (!stream)
+			return NULL;
+
+		fseek(stream, 0, SEEK_END);
+		long length = ftell(stream);
+		fseek(stream, 0, SEEK_SET);
+
+		void* base = length >= (long) sizeof(Header) ? malloc(length) : NULL;
+		if (base && fread(base, 1, length, stream) != (size_t) length) {
+			free(base);
+			base = NULL;
+		}
+		fclose(stream);
+		if (!base)
+			return NULL;
+
+		Mapping* mapping = new Mapping;
+		mapping->base = base;
+		mapping->length = length;
+		return mapping;
+#endif
+	}
+
+	void Unmap(Mapping* mapping) {
+#ifdef IMAGE_CACHE_MMAP
+		munmap(mapping->base, mapping->length);
+#else
+		free(mapping->base);
+#endif
+		delete mapping;
+	}
+
+	bool IsValid(const Mapping& mapping, const Header& key, const std::string& filename) {
+		const Header& header = *(const Header*) mapping.base;
+
+		if (memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+			header.bits != key.bits ||
+			memcmp(header.masks, key.masks, sizeof(key.masks)) != 0 ||
+			header.alpha_type != key.alpha_type ||
+			header.mtime_low != key.mtime_low ||
+			header.mtime_high != key.mtime_high ||
+			header.path_length != filename.size())
+			return false;
+
+		if (sizeof(Header) + header.path_length > mapping.length ||
+			memcmp((const char*) mapping.base + sizeof(Header), filename.data(), filename.size()) != 0)
+			return false;
+
+		// pixman requires rows aligned to 4 bytes
+		if (header.pitch < header.width * ((header.bits + 7) / 8) || header.pitch % 4 != 0 ||
+			header.data_offset % 16 != 0)
+			return false;
+
+		return header.data_offset + (size_t) header.pitch * header.height <= mapping.length;
+	}
+}
+
+void ImageCache::SetDirectory(const std::string& path) {
+	if (!path.empty() && !(FileFinder::Exists(path) && FileFinder::IsDirectory(path))) {
+		Output::Debug("Image cache: Directory %s not found", path.c_str());
+		directory.clear();
+		return;
+	}
+	directory = path;
+}
+
+bool ImageCache::IsEnabled() {
+	return !directory.empty();
+}
+
+bool ImageCache::Find(const std::string& filename, const DynamicFormat& format, Pixels& pixels) {
+	if (directory.empty())
+		return false;
+
+	Header key;
+	FillFormat(key, format);
+	FillTime(key, FileFinder::GetModifiedTime(filename));
+
+	Mapping* mapping = Map(EntryPath(filename, key));
+	if (!mapping) {
+		++stats.misses;
+		return false;
+	}
+
+	if (!IsValid(*mapping, key, filename)) {
+		Unmap(mapping);
+		++stats.misses;
+		return false;
+	}
+
+	const Header& header = *(const Header*) mapping->base;
+	pixels.width = header.width;
+	pixels.height = header.height;
+	pixels.pitch = header.pitch;
+	pixels.data = (uint8_t*) mapping->base + header.data_offset;
+	pixels.handle = mapping;
+
+	++stats.hits;
+	return true;
+}
+
+void ImageCache::Release(void* handle) {
+	Unmap((Mapping*) handle);
+}
+
+void ImageCache::Store(const std::string& filename, const DynamicFormat& format,
+					   int width, int height, int pitch, const void* data) {
+	if (directory.empty())
+		return;
+
+	Header header;
+	memcpy(header.magic, magic, sizeof(magic));
+	header.width = width;
+	header.height = height;
+	// Rows padded to 4 bytes like the bitmap, pixman rejects other strides
+	header.pitch = (width * format.bytes + 3) & ~3;
+	FillFormat(header, format);
+	FillTime(header, FileFinder::GetModifiedTime(filename));
+	header.path_length = filename.size();
+	header.data_offset = (sizeof(Header) + header.path_length + 15) & ~15U;
+
+	// Written under a temporary name so a reader never maps a partial entry
+	std::string path = EntryPath(filename, header);
+	std::string temp_path = path + ".tmp";
+
+	FILE* stream = FileFinder::fopenUTF8(temp_path, "wb");
+	if (!stream) {
+		Output::Debug("Image cache: Cannot write %s", temp_path.c_str());
+		return;
+	}
+
+	static const char padding[16] = { 0 };
+	bool ok = fwrite(&header, sizeof(Header), 1, stream) == 1 &&
+		fwrite(filename.data(), 1, filename.size(), stream) == filename.size() &&
+		fwrite(padding, 1, header.data_offset - sizeof(Header) - filename.size(), stream) ==
+			header.data_offset - sizeof(Header) - filename.size();
+
+	for (int y = 0; ok && y < height; ++y) {
+		ok = fwrite((const uint8_t*) data + y * pitch, 1, header.pitch, stream) == header.pitch;
+	}
+	ok = fclose(stream) == 0 && ok;
+
+#ifdef _WIN32
+	remove(path.c_str());
+#endif
+	if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+		remove(temp_path.c_str());
+		return;
+	}
+
+	++stats.stores;
+}
+
+ImageCache::Stats ImageCache::GetStats() {
+	return stats;
+}
@@ -0,0 +1,107 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _IMAGE_CACHE_H_
+#define _IMAGE_CACHE_H_
+
+// Headers
+#include <string>
+#include "system.h"
+
+class DynamicFormat;
+
+/**
+ * ImageCache namespace.
+ * Optional directory of decoded images, stored premultiplied in the
+ * pixel format of the display so a hit skips decoding and conversion.
+ * Entries are keyed by path, modification time, size and pixel format
+ * and are memory mapped where the platform supports it.
+ */
+namespace ImageCache {
+	/**
+	 * Sets the cache directory.
+	 *
+	 * @param path existing directory, empty disables the cache.
+	 */
+	void SetDirectory(const std::string& path);
+
+	/**
+	 * Gets whether a cache directory is in use.
+	 *
+	 * @return whether the cache is enabled.
+	 */
+	bool IsEnabled();
+
+	/** Pixels of a cache hit. */
+	struct Pixels {
+		int width;
+		int height;
+		int pitch;
+		void* data;
+		/** Passed to Release once the pixels are no longer used. */
+		void* handle;
+	};
+
+	/**
+	 * Looks up a decoded image.
+	 *
+	 * @param filename image file.
+	 * @param format pixel format the image is needed in.
+	 * @param pixels receives the pixels on a hit.
+	 * @return whether a valid entry was found.
+	 */
+	bool Find(const std::string& filename, const DynamicFormat& format, Pixels& pixels);
+
+	/**
+	 * Unmaps the pixels returned by Find.
+	 *
+	 * @param handle Pixels::handle of the hit.
+	 */
+	void Release(void* handle);
+
+	/**
+	 * Stores a decoded image.
+	 *
+	 * @param filename image file the pixels were decoded from.
+	 * @param format pixel format of the pixels.
+	 * @param width image width.
+	 * @param height image height.
+	 * @param pitch bytes per row of the pixels.
+	 * @param data the pixels.
+	 */
+	void Store(const std::string& filename, const DynamicFormat& format,
+			   int width, int height, int pitch, const void* data);
+
+	/** Cache usage statistics. */
+	struct Stats {
+		/** Images served from the cache. */
+		unsigned hits;
+		/** Lookups without a valid entry. */
+		unsigned misses;
+		/** Entries written. */
+		unsigned stores;
+	};
+
+	/**
+	 * Gets the cache usage statistics.
+	 *
+	 * @return statistics.
+	 */
+	Stats GetStats();
+}
+
+#endif
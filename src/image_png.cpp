@@ -28,46 +28,66 @@
 #include "output.h"
 #include "image_png.h"
 
+namespace {
+	struct ReadBuffer {
+		const uint8_t* data;
+		size_t remaining;
+	};
+}
+
 static void read_data(png_structp png_ptr, png_bytep data, png_size_t length) {
-    png_bytep* bufp = (png_bytep*) png_get_io_ptr(png_ptr);
-	memcpy(data, *bufp, length);
-	*bufp += length;
+	ReadBuffer* buf = (ReadBuffer*) png_get_io_ptr(png_ptr);
+	if (length > buf->remaining) {
+		png_error(png_ptr, "Unexpected end of PNG data");
+	}
+	memcpy(data, buf->data, length);
+	buf->data += length;
+	buf->remaining -= length;
 }
 
-static void on_png_warning(png_structp, png_const_charp warn_msg) {
-	Output::Debug("%s", warn_msg);
+// Images may be decoded on a worker thread, which must not write to the
+// log. Errors unwind to ReadPNG, which returns with pixels set to NULL.
+static void on_png_warning(png_structp, png_const_charp) {
 }
 
-static void on_png_error(png_structp, png_const_charp error_msg) {
-	Output::Error("%s", error_msg);
+static void on_png_error(png_structp png_ptr, png_const_charp) {
+	longjmp(png_jmpbuf(png_ptr), 1);
 }
 
 static void ReadPalettedData(png_struct*, png_info*, png_uint_32, png_uint_32, bool, uint32_t*);
+static void ReadPalettedIndices(png_struct*, png_info*, png_uint_32, png_uint_32, bool, uint8_t*, uint32_t*);
 static void ReadGrayData(png_struct*, png_info*, png_uint_32, png_uint_32, bool, uint32_t*);
 static void ReadGrayAlphaData(png_struct*, png_info*, png_uint_32, png_uint_32, uint32_t*);
 static void ReadRGBData(png_struct*, png_info*, png_uint_32, png_uint_32, uint32_t*);
 static void ReadRGBAData(png_struct*, png_info*, png_uint_32, png_uint_32, uint32_t*);
 
-void ImagePNG::ReadPNG(FILE* stream, const void* buffer, bool transparent,
-					int& width, int& height, void*& pixels) {
+bool ImagePNG::ReadPNG(FILE* stream, const void* buffer, size_t size, bool transparent,
+					int& width, int& height, void*& pixels, uint32_t* palette) {
 	pixels = NULL;
 
 	png_struct *png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, on_png_error, on_png_warning);
 	if (png_ptr == NULL) {
-		Output::Error("Couldn't allocate PNG structure");
-		return;
+		return false;
 	}
 
 	png_info *info_ptr = png_create_info_struct(png_ptr);
 	if (info_ptr == NULL) {
-		Output::Error("Couldn't allocate PNG info structure");
-		return;
+		png_destroy_read_struct(&png_ptr, NULL, NULL);
+		return false;
 	}
 
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		free(pixels);
+		pixels = NULL;
+		return false;
+	}
+
+	ReadBuffer read_buffer = { (const uint8_t*) buffer, size };
 	if (stream != NULL)
 		png_init_io(png_ptr, stream);
 	else
-		png_set_read_fn(png_ptr, (png_voidp) &buffer, read_data);
+		png_set_read_fn(png_ptr, (png_voidp) &read_buffer, read_data);
 
 	png_read_info(png_ptr, info_ptr);
 
@@ -79,6 +99,15 @@ void ImagePNG::ReadPNG(FILE* stream, const void* buffer, bool transparent,
 	width = w;
 	height = h;
 
+	if (palette != NULL && color_type == PNG_COLOR_TYPE_PALETTE) {
+		pixels = malloc(((w + 3) & ~3) * h);
+		ReadPalettedIndices(png_ptr, info_ptr, w, h, transparent, (uint8_t*)pixels, palette);
+
+		png_read_end(png_ptr, NULL);
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		return true;
+	}
+
 	pixels = malloc(w * h * 4);
 
 	switch (color_type) {
@@ -101,6 +130,7 @@ void ImagePNG::ReadPNG(FILE* stream, const void* buffer, bool transparent,
 
 	png_read_end(png_ptr, NULL);
 	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+	return false;
 }
 
 static void ReadPalettedData(
@@ -117,7 +147,7 @@ static void ReadPalettedData(
 		png_read_update_info(png_ptr, info_ptr);
 
 		if (!png_get_valid(png_ptr, info_ptr, PNG_INFO_PLTE)) {
-			Output::Error("Palette PNG without PLTE block");
+			png_error(png_ptr, "Palette PNG without PLTE block");
 		}
 
 		png_colorp palette;
@@ -159,6 +189,38 @@ static void ReadPalettedData(
 	}
 }
 
+static void ReadPalettedIndices(
+	png_struct* png_ptr, png_info* info_ptr,
+	png_uint_32 w, png_uint_32 h,
+	bool transparent,
+	uint8_t* pixels, uint32_t* out_palette
+) {
+	png_set_packing(png_ptr);
+	png_read_update_info(png_ptr, info_ptr);
+
+	if (!png_get_valid(png_ptr, info_ptr, PNG_INFO_PLTE)) {
+		png_error(png_ptr, "Palette PNG without PLTE block");
+	}
+
+	png_colorp palette;
+	int num_palette;
+	png_get_PLTE(png_ptr, info_ptr, &palette, &num_palette);
+
+	// Same alpha as ReadPalettedData: only index 0 is transparent
+	memset(out_palette, 0, 256 * sizeof(uint32_t));
+	for (int i = 0; i < num_palette && i < 256; i++) {
+		png_color& color = palette[i];
+		uint8_t rgba[4] = { color.red, color.green, color.blue,
+							(uint8_t) ((transparent && i == 0) ? 0 : 255) };
+		memcpy(&out_palette[i], rgba, 4);
+	}
+
+	png_uint_32 pitch = (w + 3) & ~3;
+	for (png_uint_32 y = 0; y < h; y++) {
+		png_read_row(png_ptr, (png_bytep) pixels + y * pitch, NULL);
+	}
+}
+
 static void ReadGrayData(
 	png_struct* png_ptr, png_info* info_ptr,
 	png_uint_32 w, png_uint_32 h,
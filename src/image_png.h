@@ -26,7 +26,12 @@
 #include "system.h"
 
 namespace ImagePNG {
-	void ReadPNG(FILE* stream, const void* buffer, bool transparent, int& width, int& height, void*& pixels);
+	// With a palette, paletted images are kept as indices, rows padded
+	// to 4 bytes, and the palette receives 256 r8g8b8a8 entries.
+	// Reads from stream, or from the size bytes at buffer when stream is
+	// NULL. Returns whether the pixels are indices, pixels is NULL when
+	// the file is invalid.
+	bool ReadPNG(FILE* stream, const void* buffer, size_t size, bool transparent, int& width, int& height, void*& pixels, uint32_t* palette = NULL);
 	bool WritePNG(std::ostream& os, uint32_t width, uint32_t height, uint32_t* data);
 }
 
@@ -23,16 +23,14 @@
 #include <cstring>
 #include <zlib.h>
 #include <vector>
-#include "output.h"
 #include "image_xyz.h"
 
-void ImageXYZ::ReadXYZ(const uint8_t* data, unsigned len, bool transparent,
-					int& width, int& height, void*& pixels) {
+bool ImageXYZ::ReadXYZ(const uint8_t* data, unsigned len, bool transparent,
+					int& width, int& height, void*& pixels, uint32_t* out_palette) {
 	pixels = NULL;
 
     if (len < 8 || strncmp((char *) data, "XYZ1", 4) != 0) {
-		Output::Error("Not a valid XYZ file.");
-		return;
+		return false;
     }
 
     unsigned short w = data[4] + (data[5] << 8);
@@ -45,13 +43,27 @@ void ImageXYZ::ReadXYZ(const uint8_t* data, unsigned len, bool transparent,
 
     int status = uncompress(&dst_buffer.front(), &dst_size, src_buffer, src_size);
 	if (status != Z_OK) {
-		Output::Error("Error decompressing XYZ file.");
-		return;
+		return false;
 	}
     const uint8_t (*palette)[3] = (const uint8_t(*)[3]) &dst_buffer.front();
 
 	width = w;
 	height = h;
+
+	if (out_palette != NULL) {
+		for (int i = 0; i < 256; i++) {
+			uint8_t rgba[4] = { palette[i][0], palette[i][1], palette[i][2],
+								(uint8_t) ((transparent && i == 0) ? 0 : 255) };
+			memcpy(&out_palette[i], rgba, 4);
+		}
+
+		int pitch = (w + 3) & ~3;
+		pixels = malloc(pitch * h);
+		for (int y = 0; y < h; y++)
+			memcpy((uint8_t*) pixels + y * pitch, &dst_buffer[768 + y * w], w);
+		return true;
+	}
+
 	pixels = malloc(w * h * 4);
 
     uint8_t* dst = (uint8_t*) pixels;
@@ -66,20 +78,25 @@ void ImageXYZ::ReadXYZ(const uint8_t* data, unsigned len, bool transparent,
 			*dst++ = (transparent && pix == 0) ? 0 : 255;
 		}
     }
+	return false;
 }
 
-void ImageXYZ::ReadXYZ(FILE* stream, bool transparent,
-					int& width, int& height, void*& pixels) {
+bool ImageXYZ::ReadXYZ(FILE* stream, bool transparent,
+					int& width, int& height, void*& pixels, uint32_t* palette) {
     fseek(stream, 0, SEEK_END);
     long size = ftell(stream);
     fseek(stream, 0, SEEK_SET);
+	if (size <= 0) {
+		pixels = NULL;
+		return false;
+	}
 	std::vector<uint8_t> buffer(size);
     long size_read = fread((void*) &buffer.front(), 1, size, stream);
     if (size_read != size) {
-        Output::Error("Error reading XYZ file.");
-        return;
+		pixels = NULL;
+        return false;
     }
-	ReadXYZ(&buffer.front(), (unsigned) size, transparent, width, height, pixels);
+	return ReadXYZ(&buffer.front(), (unsigned) size, transparent, width, height, pixels, palette);
 }
 
 
@@ -22,8 +22,12 @@
 #include "system.h"
 
 namespace ImageXYZ {
-	void ReadXYZ(const uint8_t* data, unsigned len, bool transparent, int& width, int& height, void*& pixels);
-	void ReadXYZ(FILE* stream, bool transparent, int& width, int& height, void*& pixels);
+	// With a palette the pixels are kept as indices, rows padded to
+	// 4 bytes, and the palette receives 256 r8g8b8a8 entries.
+	// Returns whether the pixels are indices, pixels is NULL when the
+	// file is invalid.
+	bool ReadXYZ(const uint8_t* data, unsigned len, bool transparent, int& width, int& height, void*& pixels, uint32_t* palette = NULL);
+	bool ReadXYZ(FILE* stream, bool transparent, int& width, int& height, void*& pixels, uint32_t* palette = NULL);
 }
 
 #endif
@@ -72,6 +72,16 @@
 /** Enables or disables font smoothing. */
 #define FONT_SMOOTHING 0
 
+/**
+ * Keep paletted charsets, chipsets and similar images at one byte per
+ * pixel. Saves memory at the cost of slower blits.
+ */
+#if defined(GEKKO) || defined(PSP) || defined(OPENDINGUX) || defined(GPH)
+#  define INDEXED_IMAGES 1
+#else
+#  define INDEXED_IMAGES 0
+#endif
+
 // OUTPUT_TYPE
 //		OUTPUT_NONE - no output
 //		OUTPUT_CONSOLE - print to console
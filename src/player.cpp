@@ -16,8 +16,11 @@
  */
 
 // Headers
+#include "asset_pack.h"
 #include "async_handler.h"
 #include "audio.h"
+#include "band_pool.h"
+#include "bitmap.h"
 #include "cache.h"
 #include "filefinder.h"
 #include "game_actors.h"
@@ -31,6 +34,8 @@
 #include "game_temp.h"
 #include "game_variables.h"
 #include "graphics.h"
+#include "headless_ui.h"
+#include "image_cache.h"
 #include "inireader.h"
 #include "input.h"
 #include "ldb_reader.h"
@@ -39,6 +44,7 @@
 #include "main_data.h"
 #include "output.h"
 #include "player.h"
+#include "project_index.h"
 #include "reader_lcf.h"
 #include "reader_util.h"
 #include "scene_battle.h"
@@ -46,6 +52,7 @@
 #include "scene_map.h"
 #include "scene_title.h"
 #include "system.h"
+#include "text.h"
 #include "utils.h"
 
 #include <algorithm>
@@ -85,6 +92,11 @@ namespace Player {
 	int start_map_id;
 	bool no_rtp_flag;
 	bool no_audio_flag;
+	bool headless_flag;
+	std::string headless_input;
+	int headless_frames;
+	std::string pack_file;
+	std::string create_pack_file;
 	std::string encoding;
 	std::string escape_symbol;
 	int engine;
@@ -141,10 +153,28 @@ void Player::Init(int argc, char *argv[]) {
 		Main_Data::Init();
 	}
 
+	if (!create_pack_file.empty()) {
+		exit(AssetPack::Create(Main_Data::project_path, create_pack_file) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	if (!pack_file.empty()) {
+		AssetPack::Mount(pack_file);
+	}
+
 	FileFinder::Init();
 
 	DisplayUi.reset();
 
+	if (headless_flag) {
+		EASYRPG_SHARED_PTR<HeadlessUi> headless_ui =
+			EASYRPG_MAKE_SHARED<HeadlessUi>(SCREEN_TARGET_WIDTH, SCREEN_TARGET_HEIGHT);
+		if (!headless_input.empty()) {
+			headless_ui->LoadScript(headless_input);
+		}
+		headless_ui->SetFrameLimit(headless_frames);
+		DisplayUi = headless_ui;
+	}
+
 	if(! DisplayUi) {
 		DisplayUi = BaseUi::CreateUi
 			(SCREEN_TARGET_WIDTH,
@@ -236,6 +266,7 @@ void Player::Update(bool update_scene) {
 	}
 
 	DisplayUi->ProcessEvents();
+	AsyncHandler::Update();
 
 	if (exit_flag) {
 		Scene::PopUntil(Scene::Null);
@@ -284,6 +315,7 @@ void Player::Exit() {
 	DisplayUi->UpdateDisplay();
 #endif
 
+	AsyncHandler::Quit();
 	Main_Data::Cleanup();
 	Graphics::Quit();
 	FileFinder::Quit();
@@ -315,6 +347,9 @@ void Player::ParseCommandLine(int argc, char *argv[]) {
 	start_map_id = -1;
 	no_rtp_flag = false;
 	no_audio_flag = false;
+	headless_flag = false;
+	headless_input = "";
+	headless_frames = 0;
 
 	std::vector<std::string> args;
 
@@ -441,6 +476,91 @@ void Player::ParseCommandLine(int argc, char *argv[]) {
 		else if (*it == "--disable-rtp") {
 			no_rtp_flag = true;
 		}
+		else if (*it == "--headless") {
+			headless_flag = true;
+			no_audio_flag = true;
+			Output::IgnorePause(true);
+			// Scripted runs must not depend on how fast files load
+			AsyncHandler::SetThreads(0);
+		}
+		else if (*it == "--headless-frames") {
+			++it;
+			if (it == args.end()) {
+				return;
+			}
+			headless_frames = atoi((*it).c_str());
+		}
+		else if (*it == "--headless-input") {
+			++it;
+			if (it == args.end()) {
+				return;
+			}
+			// case sensitive
+			headless_input = argv[it - args.begin() + 1];
+		}
+		else if (*it == "--cache-size") {
+			++it;
+			if (it == args.end()) {
+				return;
+			}
+			Cache::SetRetainLimit(atoi((*it).c_str()) * 1024 * 1024);
+		}
+		else if (*it == "--text-cache-size") {
+			++it;
+			if (it == args.end()) {
+				return;
+			}
+			Text::SetCacheLimit(atoi((*it).c_str()) * 1024);
+		}
+		else if (*it == "--indexed-images") {
+			Bitmap::SetIndexedImages(true);
+		}
+		else if (*it == "--image-cache") {
+			++it;
+			if (it == args.end()) {
+				return;
+			}
+			// case sensitive
+			ImageCache::SetDirectory(argv[it - args.begin() + 1]);
+		}
+		else if (*it == "--index-cache") {
+			++it;
+			if (it == args.end()) {
+				return;
+			}
+			// case sensitive
+			ProjectIndex::SetDirectory(argv[it - args.begin() + 1]);
+		}
+		else if (*it == "--pack") {
+			++it;
+			if (it == args.end()) {
+				return;
+			}
+			// case sensitive
+			pack_file = argv[it - args.begin() + 1];
+		}
+		else if (*it == "--create-pack") {
+			++it;
+			if (it == args.end()) {
+				return;
+			}
+			// case sensitive
+			create_pack_file = argv[it - args.begin() + 1];
+		}
+		else if (*it == "--load-threads") {
+			++it;
+			if (it == args.end()) {
+				return;
+			}
+			AsyncHandler::SetThreads(atoi((*it).c_str()));
+		}
+		else if (*it == "--render-threads") {
+			++it;
+			if (it == args.end()) {
+				return;
+			}
+			BandPool::SetThreads(atoi((*it).c_str()));
+		}
 		else if (*it == "--version" || *it == "-v") {
 			PrintVersion();
 			exit(0);
@@ -669,6 +789,12 @@ void Player::PrintUsage() {
 	//                                                  "                                Line end marker -> "
 	std::cout << "      " << "--battle-test N      " << "Start a battle test with monster party N." << std::endl;
 
+	std::cout << "      " << "--cache-size N       " << "Keep up to N MiB of unused images in memory" << std::endl;
+	std::cout << "      " << "                     " << "(default 16)." << std::endl;
+
+	std::cout << "      " << "--create-pack FILE   " << "Pack the files of the game into the asset pack" << std::endl;
+	std::cout << "      " << "                     " << "FILE and exit." << std::endl;
+
 	std::cout << "      " << "--disable-audio      " << "Disable audio (in case you prefer your own music)." << std::endl;
 
 	std::cout << "      " << "--disable-rtp        " << "Disable support for the Runtime Package (RTP)." << std::endl;
@@ -684,17 +810,43 @@ void Player::PrintUsage() {
 
 	std::cout << "      " << "--fullscreen         " << "Start in fullscreen mode." << std::endl;
 
+	std::cout << "      " << "--headless           " << "Run without a display or audio on a virtual clock" << std::endl;
+	std::cout << "      " << "                     " << "that advances one frame per update." << std::endl;
+
+	std::cout << "      " << "--headless-frames N  " << "Exit headless mode after N frames." << std::endl;
+
+	std::cout << "      " << "--headless-input F   " << "Read headless input from script F (lines of" << std::endl;
+	std::cout << "      " << "                     " << "\"FRAME KEY STATE\", e.g. \"120 RETURN 1\")." << std::endl;
+
 	std::cout << "      " << "--hide-title         " << "Hide the title background image and center the" << std::endl;
 	std::cout << "      " << "                     " << "command menu." << std::endl;
 
+	std::cout << "      " << "--image-cache DIR    " << "Keep decoded images in DIR and load them from there" << std::endl;
+	std::cout << "      " << "                     " << "while the image file is unchanged." << std::endl;
+
+	std::cout << "      " << "--index-cache DIR    " << "Keep the file lists of the game and the RTP in DIR" << std::endl;
+	std::cout << "      " << "                     " << "and only list directories that changed." << std::endl;
+
+	std::cout << "      " << "--indexed-images     " << "Keep paletted charsets, chipsets, facesets and" << std::endl;
+	std::cout << "      " << "                     " << "monsters at one byte per pixel to save memory." << std::endl;
+
 	std::cout << "      " << "--load-game-id N     " << "Skip the title scene and load SaveN.lsd" << std::endl;
 	std::cout << "      " << "                     " << "(N is padded to two digits)." << std::endl;
 
+	std::cout << "      " << "--load-threads N     " << "Decode requested images on N background threads" << std::endl;
+	std::cout << "      " << "                     " << "(default 2, 0 loads them on demand)." << std::endl;
+
 	std::cout << "      " << "--new-game           " << "Skip the title scene and start a new game directly." << std::endl;
 
+	std::cout << "      " << "--pack FILE          " << "Run the game from the asset pack FILE instead of" << std::endl;
+	std::cout << "      " << "                     " << "the files in the game directory." << std::endl;
+
 	std::cout << "      " << "--project-path PATH  " << "Instead of using the working directory the game in" << std::endl;
 	std::cout << "      " << "                     " << "PATH is used." << std::endl;
 
+	std::cout << "      " << "--render-threads N   " << "Split tone and waver effects into bands drawn by" << std::endl;
+	std::cout << "      " << "                     " << "N threads (default 1)." << std::endl;
+
 	std::cout << "      " << "--seed N            " << "Seeds the random number generator with N." << std::endl;
 
 	std::cout << "      " << "--start-map-id N     " << "Overwrite the map used for new games and use." << std::endl;
@@ -711,6 +863,9 @@ void Player::PrintUsage() {
 
 	std::cout << "      " << "--test-play          " << "Enable TestPlay mode." << std::endl;
 
+	std::cout << "      " << "--text-cache-size N  " << "Keep up to N KiB of drawn text in memory" << std::endl;
+	std::cout << "      " << "                     " << "(default 1024, 0 draws all text again)." << std::endl;
+
 	std::cout << "      " << "--window             " << "Start in window mode." << std::endl;
 
 	std::cout << "  -v, " << "--version            " << "Display program version and exit." << std::endl;
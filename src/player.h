@@ -193,6 +193,21 @@ namespace Player {
 	/** Mutes audio playback */
 	extern bool no_audio_flag;
 
+	/** Runs without a display on a virtual clock */
+	extern bool headless_flag;
+
+	/** Input script used in headless mode */
+	extern std::string headless_input;
+
+	/** Frames after which headless mode exits, 0 for no limit */
+	extern int headless_frames;
+
+	/** Asset pack mounted as the game files */
+	extern std::string pack_file;
+
+	/** Asset pack to create from the game files instead of running */
+	extern std::string create_pack_file;
+
 	/** Encoding used */
 	extern std::string encoding;
 
@@ -0,0 +1,319 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <vector>
+#include "project_index.h"
+#include "main_data.h"
+#include "output.h"
+#include "utils.h"
+
+namespace {
+	std::string directory;
+	ProjectIndex::Stats stats = { 0, 0 };
+
+	const char magic[4] = { 'E', 'P', 'I', '1' };
+
+	struct Entry {
+		std::string name;
+		bool directory;
+	};
+
+	struct Listing {
+		std::time_t mtime;
+		std::vector<Entry> entries;
+		/** Whether the listing was seen while building the current tree. */
+		bool used;
+	};
+
+	// Directory listings of one tree, by path relative to its root
+	typedef std::map<std::string, Listing> listing_map;
+
+	struct Index {
+		listing_map listings;
+		bool dirty;
+	};
+
+	// Indexes of the trees created in this session, by root path
+	std::map<std::string, Index> indexes;
+
+	uint32_t Hash(const std::string& data) {
+		uint32_t hash = 2166136261U;
+		for (size_t i = 0; i < data.size(); ++i) {
+			hash ^= (uint8_t) data[i];
+			hash *= 16777619U;
+		}
+		return hash;
+	}
+
+	std::string IndexPath(const std::string& root) {
+		char name[32];
+		sprintf(name, "%08x.idx", Hash(root));
+		return FileFinder::MakePath(directory, name);
+	}
+
+	void WriteU32(std::vector<char>& out, uint32_t value) {
+		out.insert(out.end(), (const char*) &value, (const char*) &value + sizeof(value));
+	}
+
+	void WriteString(std::vector<char>& out, const std::string& value) {
+		WriteU32(out, value.size());
+		out.insert(out.end(), value.begin(), value.end());
+	}
+
+	/** Bounds checked reader of an index file. */
+	struct Reader {
+		const char* pos;
+		const char* end;
+
+		bool ReadU32(uint32_t& value) {
+			if ((size_t) (end - pos) < sizeof(value))
+				return false;
+			memcpy(&value, pos, sizeof(value));
+			pos += sizeof(value);
+			return true;
+		}
+
+		bool ReadString(std::string& value) {
+			uint32_t length;
+			if (!ReadU32(length) || (size_t) (end - pos) < length)
+				return false;
+			value.assign(pos, length);
+			pos += length;
+			return true;
+		}
+	};
+
+	bool Parse(const std::vector<char>& data, const std::string& root, listing_map& listings) {
+		Reader in = { &data[0], &data[0] + data.size() };
+
+		std::string file_root;
+		uint32_t count;
+		if (data.size() < sizeof(magic) || memcmp(&data[0], magic, sizeof(magic)) != 0)
+			return false;
+		in.pos += sizeof(magic);
+		if (!in.ReadString(file_root) || file_root != root || !in.ReadU32(count))
+			return false;
+
+		for (uint32_t i = 0; i < count; ++i) {
+			std::string path;
+			uint32_t mtime_low, mtime_high, entries;
+			if (!in.ReadString(path) || !in.ReadU32(mtime_low) || !in.ReadU32(mtime_high) ||
+				!in.ReadU32(entries))
+				return false;
+
+			Listing& listing = listings[path];
+			listing.mtime = (std::time_t) (((uint64_t) mtime_high << 32) | mtime_low);
+			listing.used = false;
+			listing.entries.resize(entries);
+			for (uint32_t j = 0; j < entries; ++j) {
+				uint32_t is_directory;
+				if (!in.ReadU32(is_directory) || !in.ReadString(listing.entries[j].name))
+					return false;
+				listing.entries[j].directory = is_directory != 0;
+			}
+		}
+		return true;
+	}
+
+	void Load(const std::string& root, Index& index) {
+		index.dirty = false;
+
+		FILE* stream = FileFinder::fopenUTF8(IndexPath(root), "rb");
+		if (!stream)
+			return;
+
+		fseek(stream, 0, SEEK_END);
+		long length = ftell(stream);
+		fseek(stream, 0, SEEK_SET);
+
+		std::vector<char> data(length > 0 ? length : 0);
+		bool ok = !data.empty() && fread(&data[0], 1, data.size(), stream) == data.size();
+		fclose(stream);
+
+		if (!ok || !Parse(data, root, index.listings)) {
+			Output::Debug("Project index: Ignoring invalid index of %s", root.c_str());
+			index.listings.clear();
+		}
+	}
+
+	void Save(const std::string& root, Index& index) {
+		std::vector<char> out(magic, magic + sizeof(magic));
+		WriteString(out, root);
+		WriteU32(out, index.listings.size());
+		for (listing_map::const_iterator it = index.listings.begin(); it != index.listings.end(); ++it) {
+			uint64_t mtime = (uint64_t) it->second.mtime;
+			WriteString(out, it->first);
+			WriteU32(out, (uint32_t) mtime);
+			WriteU32(out, (uint32_t) (mtime >> 32));
+			WriteU32(out, it->second.entries.size());
+			for (std::vector<Entry>::const_iterator e = it->second.entries.begin(); e != it->second.entries.end(); ++e) {
+				WriteU32(out, e->directory ? 1 : 0);
+				WriteString(out, e->name);
+			}
+		}
+
+		// Written under a temporary name so a reader never sees a partial index
+		std::string path = IndexPath(root);
+		std::string temp_path = path + ".tmp";
+
+		FILE* stream = FileFinder::fopenUTF8(temp_path, "wb");
+		if (!stream) {
+			Output::Debug("Project index: Cannot write %s", temp_path.c_str());
+			return;
+		}
+		bool ok = fwrite(&out[0], 1, out.size(), stream) == out.size();
+		ok = fclose(stream) == 0 && ok;
+
+#ifdef _WIN32
+		remove(path.c_str());
+#endif
+		if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+			remove(temp_path.c_str());
+			return;
+		}
+		index.dirty = false;
+	}
+
+	/**
+	 * Gets the listing of a directory, reading the directory only when
+	 * its modification time differs from the indexed one.
+	 */
+	const Listing& List(Index& index, const std::string& root, const std::string& relative) {
+		std::string const path = relative.empty() ? root : FileFinder::MakePath(root, relative);
+		std::time_t const mtime = FileFinder::GetModifiedTime(path);
+
+		std::pair<listing_map::iterator, bool> const it =
+			index.listings.insert(std::make_pair(relative, Listing()));
+		Listing& listing = it.first->second;
+		listing.used = true;
+
+		if (!it.second && listing.mtime == mtime && mtime != 0) {
+			++stats.reused;
+			return listing;
+		}
+
+		listing.entries.clear();
+		FileFinder::Directory const members = FileFinder::GetDirectoryMembers(path, FileFinder::ALL);
+		for (FileFinder::string_map::const_iterator i = members.members.begin(); i != members.members.end(); ++i) {
+			Entry entry;
+			entry.name = i->second;
+			entry.directory = FileFinder::IsDirectory(FileFinder::MakePath(path, i->second));
+			listing.entries.push_back(entry);
+		}
+
+		// A change within the same second as the listing would keep the
+		// modification time, so such listings are read again next time
+		listing.mtime = mtime + 1 < std::time(NULL) ? mtime : 0;
+		index.dirty = true;
+		++stats.scanned;
+
+		return listing;
+	}
+
+	/** Collects the files below a directory like FileFinder::RECURSIVE. */
+	void ListRecursive(Index& index, const std::string& root, const std::string& relative,
+					   const std::string& parent, FileFinder::string_map& members) {
+		std::vector<Entry> const& entries = List(index, root, relative).entries;
+
+		for (std::vector<Entry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+			std::string const name = FileFinder::MakePath(parent, it->name);
+			if (it->directory) {
+				ListRecursive(index, root, FileFinder::MakePath(relative, it->name), name, members);
+			} else {
+				members[Utils::LowerCase(name)] = name;
+			}
+		}
+	}
+}
+
+void ProjectIndex::SetDirectory(const std::string& path) {
+	if (!path.empty() && !(FileFinder::Exists(path) && FileFinder::IsDirectory(path))) {
+		Output::Debug("Project index: Directory %s not found", path.c_str());
+		directory.clear();
+		return;
+	}
+	directory = path;
+	indexes.clear();
+}
+
+bool ProjectIndex::IsEnabled() {
+	return !directory.empty();
+}
+
+EASYRPG_SHARED_PTR<FileFinder::ProjectTree> ProjectIndex::CreateProjectTree(std::string const& path, bool recursive) {
+	using FileFinder::ProjectTree;
+
+	std::map<std::string, Index>::iterator it = indexes.find(path);
+	if (it == indexes.end()) {
+		it = indexes.insert(std::make_pair(path, Index())).first;
+		Load(path, it->second);
+	}
+	Index& index = it->second;
+
+	EASYRPG_SHARED_PTR<ProjectTree> tree = EASYRPG_MAKE_SHARED<ProjectTree>();
+	tree->project_path = path;
+
+	for (listing_map::iterator i = index.listings.begin(); i != index.listings.end(); ++i) {
+		i->second.used = false;
+	}
+
+	std::vector<Entry> const entries = List(index, path, "").entries;
+	for (std::vector<Entry>::const_iterator i = entries.begin(); i != entries.end(); ++i) {
+		if (i->directory) {
+			if (recursive) {
+				tree->directories[Utils::LowerCase(i->name)] = i->name;
+			}
+		} else {
+			tree->files[Utils::LowerCase(i->name)] = i->name;
+		}
+	}
+
+	// Stop here if the tree is invalid
+	bool complete = recursive &&
+		!(path == Main_Data::project_path && !FileFinder::IsRPG2kProject(*tree) && !FileFinder::IsEasyRpgProject(*tree));
+
+	if (complete) {
+		for (FileFinder::string_map::const_iterator i = tree->directories.begin(); i != tree->directories.end(); ++i) {
+			ListRecursive(index, path, i->second, "", tree->sub_members[i->first]);
+		}
+
+		// Drop the listings of removed directories
+		for (listing_map::iterator i = index.listings.begin(); i != index.listings.end();) {
+			if (i->second.used) {
+				++i;
+			} else {
+				index.listings.erase(i++);
+				index.dirty = true;
+			}
+		}
+	}
+
+	if (index.dirty) {
+		Save(path, index);
+	}
+
+	return tree;
+}
+
+ProjectIndex::Stats ProjectIndex::GetStats() {
+	return stats;
+}
@@ -0,0 +1,74 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _PROJECT_INDEX_H_
+#define _PROJECT_INDEX_H_
+
+// Headers
+#include <string>
+#include "system.h"
+#include "filefinder.h"
+
+/**
+ * ProjectIndex namespace.
+ * Remembers the directory listings of project and RTP trees and stores
+ * them in a cache directory. A listing is reused while the modification
+ * time of its directory is unchanged, so only directories that changed
+ * are read again.
+ */
+namespace ProjectIndex {
+	/**
+	 * Sets the directory the index files are stored in.
+	 *
+	 * @param path existing directory, empty disables the index.
+	 */
+	void SetDirectory(const std::string& path);
+
+	/**
+	 * Gets whether the index is in use.
+	 *
+	 * @return whether the index is enabled.
+	 */
+	bool IsEnabled();
+
+	/**
+	 * Creates a project tree like FileFinder::CreateProjectTree from the
+	 * index, listing only directories that changed since the last call.
+	 *
+	 * @param path existing root directory of the tree.
+	 * @param recursive whether to list the subdirectories.
+	 * @return project tree.
+	 */
+	EASYRPG_SHARED_PTR<FileFinder::ProjectTree> CreateProjectTree(std::string const& path, bool recursive);
+
+	/** Index statistics. */
+	struct Stats {
+		/** Directory listings taken from the index. */
+		unsigned reused;
+		/** Directories read because they are new or changed. */
+		unsigned scanned;
+	};
+
+	/**
+	 * Gets the index statistics.
+	 *
+	 * @return statistics.
+	 */
+	Stats GetStats();
+}
+
+#endif
@@ -42,11 +42,15 @@
 
 Scene_Battle_Rpg2k3::Scene_Battle_Rpg2k3() : Scene_Battle(),
 	battle_action_wait(30),
-	battle_action_state(BattleActionState_Start)
+	battle_action_state(BattleActionState_Start),
+	request(NULL)
 {
 }
 
 Scene_Battle_Rpg2k3::~Scene_Battle_Rpg2k3() {
+	if (request) {
+		request->Unbind(request_id);
+	}
 }
 
 void Scene_Battle_Rpg2k3::Update() {
@@ -111,8 +115,11 @@ void Scene_Battle_Rpg2k3::CreateCursors() {
 	ally_cursor.reset(new Sprite());
 	enemy_cursor.reset(new Sprite());
 
-	FileRequestAsync* request = AsyncHandler::RequestFile("System2", Data::system.system2_name);
-	request->Bind(&Scene_Battle_Rpg2k3::OnSystem2Ready, this);
+	if (request) {
+		request->Unbind(request_id);
+	}
+	request = AsyncHandler::RequestFile("System2", Data::system.system2_name);
+	request_id = request->Bind(&Scene_Battle_Rpg2k3::OnSystem2Ready, this);
 	request->Start();
 }
 
@@ -40,6 +40,8 @@
 #include "battle_animation.h"
 #include <boost/scoped_ptr.hpp>
 
+class FileRequestAsync;
+
 namespace Battle {
 class Action;
 class SpriteAction;
@@ -104,6 +106,9 @@ protected:
 	int battle_action_state;
 
 	boost::scoped_ptr<Window_BattleStatus> enemy_status_window;
+
+	FileRequestAsync* request;
+	int request_id;
 };
 
 #endif
@@ -24,14 +24,21 @@
 #include "input.h"
 #include "main_data.h"
 
-Scene_Gameover::Scene_Gameover() {
+Scene_Gameover::Scene_Gameover() :
+	request(NULL) {
 	type = Scene::Gameover;
 }
 
+Scene_Gameover::~Scene_Gameover() {
+	if (request) {
+		request->Unbind(request_id);
+	}
+}
+
 void Scene_Gameover::Start() {
 	if (!Data::system.gameover_name.empty()) {
-		FileRequestAsync* request = AsyncHandler::RequestFile("GameOver", Data::system.gameover_name);
-		request->Bind(&Scene_Gameover::OnBackgroundReady, this);
+		request = AsyncHandler::RequestFile("GameOver", Data::system.gameover_name);
+		request_id = request->Bind(&Scene_Gameover::OnBackgroundReady, this);
 		request->Start();
 	}
 	// Play gameover music
@@ -23,6 +23,7 @@
 #include "sprite.h"
 #include <boost/scoped_ptr.hpp>
 
+class FileRequestAsync;
 struct FileRequestResult;
 
 /**
@@ -36,12 +37,16 @@ public:
 	 * Constructor.
 	 */
 	Scene_Gameover();
+	~Scene_Gameover();
 
 	void Start();
 	void Update();
 private:
 	/** Background graphic. */
 	boost::scoped_ptr<Sprite> background;
+
+	FileRequestAsync* request;
+	int request_id;
 	
 	void OnBackgroundReady(FileRequestResult* result);
 };
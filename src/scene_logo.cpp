@@ -22,6 +22,7 @@
 #include "filefinder.h"
 #include "graphics.h"
 #include "input.h"
+#include "main_data.h"
 #include "player.h"
 #include "scene_map.h"
 #include "scene_title.h"
@@ -960,7 +961,9 @@ void Scene_Logo::Update() {
 			std::stringstream ss;
 			ss << "Save" << (Player::load_game_id <= 9 ? "0" : "") << Player::load_game_id << ".lsd";
 
-			std::string save_name = FileFinder::FindDefault(ss.str());
+			// Saves are next to a mounted asset pack, not inside of it
+			EASYRPG_SHARED_PTR<FileFinder::ProjectTree> tree = FileFinder::CreateProjectTree(Main_Data::project_path, false);
+			std::string save_name = tree ? FileFinder::FindDefault(*tree, ss.str()) : std::string();
 			Player::LoadSavegame(save_name);
 			Scene::Push(EASYRPG_MAKE_SHARED<Scene_Map>(true));
 		}
@@ -49,10 +49,17 @@
 #include "util_macro.h"
 #include "window_command.h"
 
-Scene_Title::Scene_Title() {
+Scene_Title::Scene_Title() :
+	request(NULL) {
 	type = Scene::Title;
 }
 
+Scene_Title::~Scene_Title() {
+	if (request) {
+		request->Unbind(request_id);
+	}
+}
+
 void Scene_Title::Start() {
 	if (!Player::battle_test_flag && !Player::hide_title_flag) {
 		CreateTitleGraphic();
@@ -144,8 +151,8 @@ void Scene_Title::CreateTitleGraphic() {
 	if (!title) // No need to recreate Title on Resume
 	{
 		title.reset(new Sprite());
-		FileRequestAsync* request = AsyncHandler::RequestFile("Title", Data::system.title_name);
-		request->Bind(&Scene_Title::OnTitleSpriteReady, this);
+		request = AsyncHandler::RequestFile("Title", Data::system.title_name);
+		request_id = request->Bind(&Scene_Title::OnTitleSpriteReady, this);
 		request->Start();
 	}
 }
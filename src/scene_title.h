@@ -25,6 +25,8 @@
 #include <boost/scoped_ptr.hpp>
 #include <vector>
 
+class FileRequestAsync;
+
 /**
  * Scene Title class.
  */
@@ -34,6 +36,7 @@ public:
 	 * Constructor.
 	 */
 	Scene_Title();
+	~Scene_Title();
 
 	void Start();
 	void Continue();
@@ -110,6 +113,9 @@ private:
 
 	/** Contains the state of continue button. */
 	bool continue_enabled;
+
+	FileRequestAsync* request;
+	int request_id;
 };
 
 #endif
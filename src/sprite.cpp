@@ -22,6 +22,7 @@
 #include "graphics.h"
 #include "util_macro.h"
 #include "bitmap.h"
+#include "cache.h"
 
 // Constructor
 Sprite::Sprite() :
@@ -52,7 +53,7 @@ Sprite::Sprite() :
 	waver_effect_phase(0.0),
 	flash_effect(Color(0,0,0,0)),
 	bitmap_effects_src_rect(Rect()),
-	bitmap_effects_valid(false),
+	bitmap_effects_revision(0),
 
 	current_tone(Tone()),
 	current_flash(Color(0,0,0,0)),
@@ -80,6 +81,10 @@ void Sprite::BlitScreen(int x, int y, int ox, int oy, Rect const& src_rect) {
 		return;
 
 	Rect rect = src_rect_effect.GetSubRect(src_rect);
+	rect.Adjust(bitmap->GetWidth(), bitmap->GetHeight());
+
+	// Refresh may move rect into a cropped variant, the wave keeps its phase
+	int const waver_row = rect.y;
 
 	BitmapRef draw_bitmap = Refresh(rect);
 
@@ -87,12 +92,12 @@ void Sprite::BlitScreen(int x, int y, int ox, int oy, Rect const& src_rect) {
 	needs_refresh = false;
 
 	if(draw_bitmap) {
-		BlitScreenIntern(*draw_bitmap, x, y, ox, oy, rect, bush_effect);
+		BlitScreenIntern(*draw_bitmap, x, y, ox, oy, rect, bush_effect, waver_row);
 	}
 }
 
 void Sprite::BlitScreenIntern(Bitmap const& draw_bitmap, int x, int y, int ox, int oy,
-								Rect const& src_rect, int opacity_split) {
+								Rect const& src_rect, int opacity_split, int waver_row) {
 	if (! &draw_bitmap)
 		return;
 
@@ -104,7 +109,7 @@ void Sprite::BlitScreenIntern(Bitmap const& draw_bitmap, int x, int y, int ox, i
 	dst->EffectsBlit(x, y, ox, oy, draw_bitmap, src_rect,
 					 Opacity(opacity_top_effect, opacity_bottom_effect, opacity_split),
 					 zoom_x, zoom_y, angle_effect * 3.14159 / 180,
-					 waver_effect_depth, waver_effect_phase);
+					 waver_effect_depth, waver_effect_phase, waver_row);
 }
 
 BitmapRef Sprite::Refresh(Rect& rect) {
@@ -118,75 +123,36 @@ BitmapRef Sprite::Refresh(Rect& rect) {
 	bool no_flash = flash_effect.alpha == 0;
 	bool no_flip = !flipx_effect && !flipy_effect;
 	bool no_effects = no_tone && no_flash && no_flip;
+
+	if (no_effects) {
+		// Let the effect cache release the variant
+		bitmap_effects.reset();
+		return bitmap;
+	}
+
 	bool effects_changed = tone_effect != current_tone ||
 		flash_effect != current_flash ||
 		flipx_effect != current_flip_x ||
 		flipy_effect != current_flip_y;
 	bool effects_rect_changed = rect != bitmap_effects_src_rect;
 
-	if (effects_changed || effects_rect_changed || bitmap_changed) {
-		bitmap_effects_valid = false;
-	}
-
-	if (no_effects)
-		return bitmap;
-
-	if (bitmap_effects && bitmap_effects_valid)
-		return bitmap_effects;
-
-	BitmapRef src_bitmap;
-
-	if (no_effects)
-		src_bitmap = bitmap;
-	else if (bitmap_effects_valid)
-		src_bitmap = bitmap_effects;
-	else {
+	if (!bitmap_effects || effects_changed || effects_rect_changed || bitmap_changed ||
+		bitmap->GetRevision() != bitmap_effects_revision) {
 		current_tone = tone_effect;
 		current_flash = flash_effect;
 		current_flip_x = flipx_effect;
 		current_flip_y = flipy_effect;
 
-		if (bitmap_effects &&
-			bitmap_effects->GetWidth() < rect.x + rect.width &&
-			bitmap_effects->GetHeight() < rect.y + rect.height) {
-		bitmap_effects.reset();
-		}
-
-		if (!bitmap_effects)
-			bitmap_effects = Bitmap::Create(bitmap->GetWidth(), bitmap->GetHeight(), true);
-
-		bitmap_effects->Clear();
-		if (no_tone && no_flash)
-			bitmap_effects->FlipBlit(rect.x, rect.y, *bitmap, rect, flipx_effect, flipy_effect);
-		else if (no_flip && no_flash)
-			bitmap_effects->ToneBlit(rect.x, rect.y, *bitmap, rect, tone_effect);
-		else if (no_flip && no_tone)
-			bitmap_effects->BlendBlit(rect.x, rect.y, *bitmap, rect, flash_effect);
-		else if (no_flash) {
-			bitmap_effects->ToneBlit(rect.x, rect.y, *bitmap, rect, tone_effect);
-			bitmap_effects->Flip(rect, flipx_effect, flipy_effect);
-		}
-		else if (no_tone) {
-			bitmap_effects->BlendBlit(rect.x, rect.y, *bitmap, rect, flash_effect);
-			bitmap_effects->Flip(rect, flipx_effect, flipy_effect);
-		}
-		else if (no_flip) {
-			bitmap_effects->BlendBlit(rect.x, rect.y, *bitmap, rect, flash_effect);
-			bitmap_effects->ToneBlit(rect.x, rect.y, *bitmap_effects, rect, tone_effect);
-		}
-		else {
-			bitmap_effects->BlendBlit(rect.x, rect.y, *bitmap, rect, flash_effect);
-			bitmap_effects->ToneBlit(rect.x, rect.y, *bitmap_effects, rect, tone_effect);
-			bitmap_effects->Flip(rect, flipx_effect, flipy_effect);
-		}
-
+		bitmap_effects = Cache::SpriteEffect(bitmap, rect, flipx_effect, flipy_effect,
+											 tone_effect, flash_effect);
 		bitmap_effects_src_rect = rect;
-		bitmap_effects_valid = true;
-
-		src_bitmap = bitmap_effects;
+		bitmap_effects_revision = bitmap->GetRevision();
 	}
 
-	return src_bitmap;
+	// The variant only contains the sprite rect
+	rect = bitmap_effects->GetRect();
+
+	return bitmap_effects;
 }
 
 int Sprite::GetWidth() const {
@@ -124,7 +124,7 @@ private:
 	BitmapRef bitmap_effects;
 
 	Rect bitmap_effects_src_rect;
-	bool bitmap_effects_valid;
+	unsigned bitmap_effects_revision;
 
 	Tone current_tone;
 	Color current_flash;
@@ -135,7 +135,7 @@ private:
 
 	void BlitScreen(int x, int y, int ox, int oy, Rect const& src_rect);
 	void BlitScreenIntern(Bitmap const& draw_bitmap, int x, int y, int ox, int oy,
-							Rect const& src_rect, int opacity_split);
+							Rect const& src_rect, int opacity_split, int waver_row);
 	BitmapRef Refresh(Rect& rect);
 	void SetFlashEffect(const Color &color);
 };
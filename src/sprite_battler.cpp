@@ -35,12 +35,16 @@ Sprite_Battler::Sprite_Battler(Game_Battler* battler) :
 	sprite_frame(-1),
 	fade_out(255),
 	flash_counter(0),
-	old_hidden(false) {
+	old_hidden(false),
+	request(NULL) {
 	
 	CreateSprite();
 }
 
 Sprite_Battler::~Sprite_Battler() {
+	if (request) {
+		request->Unbind(request_id);
+	}
 }
 
 Game_Battler* Sprite_Battler::GetBattler() const {
@@ -135,8 +139,11 @@ void Sprite_Battler::SetAnimationState(int state, LoopState loop) {
 
 			sprite_file = ext.battler_name;
 
-			FileRequestAsync* request = AsyncHandler::RequestFile("BattleCharSet", sprite_file);
-			request->Bind(boost::bind(&Sprite_Battler::OnBattlercharsetReady, this, _1, ext.battler_index));
+			if (request) {
+				request->Unbind(request_id);
+			}
+			request = AsyncHandler::RequestFile("BattleCharSet", sprite_file);
+			request_id = request->Bind(boost::bind(&Sprite_Battler::OnBattlercharsetReady, this, _1, ext.battler_index));
 			request->Start();
 		}
 	}
@@ -159,8 +166,11 @@ void Sprite_Battler::CreateSprite() {
 			SetBitmap(graphic);
 		}
 		else {
-			FileRequestAsync* request = AsyncHandler::RequestFile("Monster", sprite_name);
-			request->Bind(&Sprite_Battler::OnMonsterSpriteReady, this);
+			if (request) {
+				request->Unbind(request_id);
+			}
+			request = AsyncHandler::RequestFile("Monster", sprite_name);
+			request_id = request->Bind(&Sprite_Battler::OnMonsterSpriteReady, this);
 			request->Start();
 		}
 	}
@@ -185,9 +195,7 @@ void Sprite_Battler::OnMonsterSpriteReady(FileRequestResult* result) {
 
 	bool hue_change = hue != 0;
 	if (hue_change) {
-		BitmapRef new_graphic = Bitmap::Create(graphic->GetWidth(), graphic->GetHeight());
-		new_graphic->HueChangeBlit(0, 0, *graphic, graphic->GetRect(), hue);
-		graphic = new_graphic;
+		graphic = Cache::HueChange(graphic, hue);
 	}
 
 	SetBitmap(graphic);
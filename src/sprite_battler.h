@@ -23,6 +23,7 @@
 #include "game_battler.h"
 
 class Game_Character;
+class FileRequestAsync;
 struct FileRequestResult;
 
 /**
@@ -95,6 +96,8 @@ protected:
 	int flash_counter;
 	LoopState loop_state;
 	bool old_hidden;
+	FileRequestAsync* request;
+	int request_id;
 };
 
 #endif
@@ -33,6 +33,15 @@ Sprite_Character::Sprite_Character(Game_Character* character) :
 	Update();
 }
 
+Sprite_Character::~Sprite_Character() {
+	if (tile_request) {
+		tile_request->Unbind(tile_request_id);
+	}
+	if (char_request) {
+		char_request->Unbind(char_request_id);
+	}
+}
+
 void Sprite_Character::Update() {
 	Sprite::Update();
 	Rect r;
@@ -38,6 +38,11 @@ public:
 	 */
 	Sprite_Character(Game_Character* character);
 
+	/**
+	 * Destructor.
+	 */
+	~Sprite_Character();
+
 	/**
 	 * Updates sprite state.
 	 */
@@ -60,6 +60,15 @@ Spriteset_Map::Spriteset_Map() :
 }
 
 // Update
+Spriteset_Map::~Spriteset_Map() {
+	if (panorama_request) {
+		panorama_request->Unbind(panorama_request_id);
+	}
+	if (tilemap_request) {
+		tilemap_request->Unbind(tilemap_request_id);
+	}
+}
+
 void Spriteset_Map::Update() {
 	tilemap.SetOx(Game_Map::GetDisplayX() / (SCREEN_TILE_WIDTH / TILE_SIZE));
 	tilemap.SetOy(Game_Map::GetDisplayY() / (SCREEN_TILE_WIDTH / TILE_SIZE));
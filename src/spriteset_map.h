@@ -38,6 +38,7 @@ struct FileRequestResult;
 class Spriteset_Map {
 public:
 	Spriteset_Map();
+	~Spriteset_Map();
 
 	void Update();
 
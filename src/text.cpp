@@ -26,15 +26,137 @@
 #include "game_system.h"
 
 #include <cctype>
+#include <list>
+#include <map>
 
 #include <boost/next_prior.hpp>
 #include <boost/regex/pending/unicode_iterator.hpp>
 
+namespace {
+	struct RunKey {
+		Font const* font;
+		int color;
+		unsigned system;
+		std::string text;
+
+		bool operator<(RunKey const& other) const {
+			if (font != other.font) return font < other.font;
+			if (color != other.color) return color < other.color;
+			if (system != other.system) return system < other.system;
+			return text < other.text;
+		}
+	};
+
+	struct Run;
+	typedef std::map<RunKey, Run> run_map;
+	typedef std::list<run_map::iterator> run_lru;
+
+	struct Run {
+		// Keeps the font alive so its address can't be reused by another font
+		FontRef font;
+		BitmapRef surface;
+		run_lru::iterator lru;
+	};
+
+	run_map runs;
+	// Most recently used first
+	run_lru runs_lru;
+	size_t runs_bytes = 0;
+	size_t runs_limit = 1024 * 1024;
+	unsigned runs_hits = 0;
+	unsigned runs_misses = 0;
+
+	size_t RunBytes(Bitmap const& surface) {
+		return surface.pitch() * surface.height();
+	}
+
+	void EvictRuns(size_t limit) {
+		while (runs_bytes > limit && !runs_lru.empty()) {
+			run_map::iterator const it = runs_lru.back();
+			runs_bytes -= RunBytes(*it->second.surface);
+			runs_lru.pop_back();
+			runs.erase(it);
+		}
+	}
+
+	BitmapRef RenderRun(FontRef const& font, Bitmap const& system, int color, std::string const& text, int width, int height) {
+		BitmapRef text_surface; // Complete text will be on this surface
+		text_surface = Bitmap::Create(width, height, true);
+		text_surface->Clear();
+
+		// Where to draw the next glyph (x pos)
+		int next_glyph_pos = 0;
+
+		// The current char is an exfont
+		bool is_exfont = false;
+
+		// This loops always renders a single char, color blends it and then puts
+		// it onto the text_surface (including the drop shadow)
+		for (boost::u8_to_u32_iterator<std::string::const_iterator>
+				 c(text.begin(), text.begin(), text.end()),
+				 end(text.end(), text.begin(), text.end()); c != end; ++c) {
+			Rect next_glyph_rect(next_glyph_pos, 0, 0, 0);
+
+			boost::u8_to_u32_iterator<std::string::const_iterator> next_c_it = boost::next(c);
+			uint32_t const next_c = std::distance(c, end) > 1? *next_c_it : 0;
+
+			// ExFont-Detection: Check for A-Z or a-z behind the $
+			if (*c == '$' && std::isalpha(next_c)) {
+				int exfont_value = -1;
+				// Calculate which exfont shall be rendered
+				if (islower(next_c)) {
+					exfont_value = 26 + next_c - 'a';
+				} else if (isupper(next_c)) {
+					exfont_value = next_c - 'A';
+				} else { assert(false); }
+				is_exfont = true;
+
+				Font::exfont->Render(*text_surface, next_glyph_rect.x, next_glyph_rect.y, system, color, exfont_value);
+			} else { // Not ExFont, draw normal text
+				font->Render(*text_surface, next_glyph_rect.x, next_glyph_rect.y, system, color, *c);
+			}
+
+			// If it's a full size glyph, add the size of a half-size glyph twice
+			if (is_exfont) {
+				is_exfont = false;
+				next_glyph_pos += 12;
+				// Skip the next character
+				++c;
+			} else {
+				std::string const glyph(c.base(), next_c_it.base());
+				next_glyph_pos += font->GetSize(glyph).width;
+			}
+		}
+
+		return text_surface;
+	}
+}
+
 void Text::Draw(Bitmap& dest, int x, int y, int color, std::string const& text, Text::Alignment align) {
 	if (text.length() == 0) return;
 
 	FontRef font = dest.GetFont();
-	Rect dst_rect = font->GetSize(text);
+	BitmapRef system = Cache::System();
+
+	RunKey key;
+	key.font = font.get();
+	key.color = color;
+	key.system = system->GetId();
+	key.text = text;
+
+	BitmapRef text_bmp;
+	Rect dst_rect;
+
+	run_map::iterator const it = runs.find(key);
+	if (it != runs.end()) {
+		++runs_hits;
+		runs_lru.splice(runs_lru.begin(), runs_lru, it->second.lru);
+		text_bmp = it->second.surface;
+		// The surface has place for the shadow
+		dst_rect = Rect(0, 0, text_bmp->GetWidth() - 1, text_bmp->GetHeight() - 1);
+	} else {
+		dst_rect = font->GetSize(text);
+	}
 
 	switch (align) {
 	case Text::AlignCenter:
@@ -50,67 +172,25 @@ void Text::Draw(Bitmap& dest, int x, int y, int color, std::string const& text,
 	dst_rect.width += 1; dst_rect.height += 1; // Need place for shadow
 	if (dst_rect.IsOutOfBounds(dest.GetWidth(), dest.GetHeight())) return;
 
-	BitmapRef text_surface; // Complete text will be on this surface
-	text_surface = Bitmap::Create(dst_rect.width, dst_rect.height, true);
-	text_surface->SetTransparentColor(dest.GetTransparentColor());
-	text_surface->Clear();
-
-	BitmapRef system = Cache::System();
-
-	// Where to draw the next glyph (x pos)
-	int next_glyph_pos = 0;
-
-	// The current char is an exfont
-	bool is_exfont = false;
+	if (!text_bmp) {
+		++runs_misses;
+		text_bmp = RenderRun(font, *system, color, text, dst_rect.width, dst_rect.height);
 
-	// This loops always renders a single char, color blends it and then puts
-	// it onto the text_surface (including the drop shadow)
-	for (boost::u8_to_u32_iterator<std::string::const_iterator>
-			 c(text.begin(), text.begin(), text.end()),
-			 end(text.end(), text.begin(), text.end()); c != end; ++c) {
-		Rect next_glyph_rect(next_glyph_pos, 0, 0, 0);
+		size_t const bytes = RunBytes(*text_bmp);
+		if (bytes <= runs_limit) {
+			EvictRuns(runs_limit - bytes);
 
-		boost::u8_to_u32_iterator<std::string::const_iterator> next_c_it = boost::next(c);
-		uint32_t const next_c = std::distance(c, end) > 1? *next_c_it : 0;
-
-		// ExFont-Detection: Check for A-Z or a-z behind the $
-		if (*c == '$' && std::isalpha(next_c)) {
-			int exfont_value = -1;
-			// Calculate which exfont shall be rendered
-			if (islower(next_c)) {
-				exfont_value = 26 + next_c - 'a';
-			} else if (isupper(next_c)) {
-				exfont_value = next_c - 'A';
-			} else { assert(false); }
-			is_exfont = true;
-
-			Font::exfont->Render(*text_surface, next_glyph_rect.x, next_glyph_rect.y, *system, color, exfont_value);
-		} else { // Not ExFont, draw normal text
-			font->Render(*text_surface, next_glyph_rect.x, next_glyph_rect.y, *system, color, *c);
-		}
-
-		// If it's a full size glyph, add the size of a half-size glyph twice
-		if (is_exfont) {
-			is_exfont = false;
-			next_glyph_pos += 12;
-			// Skip the next character
-			++c;
-		} else {
-			std::string const glyph(c.base(), next_c_it.base());
-			next_glyph_pos += font->GetSize(glyph).width;
+			run_map::iterator const inserted = runs.insert(std::make_pair(key, Run())).first;
+			inserted->second.font = font;
+			inserted->second.surface = text_bmp;
+			runs_lru.push_front(inserted);
+			inserted->second.lru = runs_lru.begin();
+			runs_bytes += bytes;
 		}
 	}
 
-	BitmapRef text_bmp = Bitmap::Create(*text_surface, text_surface->GetRect());
-
 	Rect src_rect(0, 0, dst_rect.width, dst_rect.height);
-	int iy = dst_rect.y;
-	if (dst_rect.height > text_bmp->GetHeight()) {
-		iy += ((dst_rect.height - text_bmp->GetHeight()) / 2);
-	}
-	int ix = dst_rect.x;
-
-	dest.Blit(ix, iy, *text_bmp, src_rect, 255);
+	dest.Blit(dst_rect.x, dst_rect.y, *text_bmp, src_rect, 255);
 }
 
 void Text::Draw(Bitmap& dest, int x, int y, Color color, std::string const& text) {
@@ -138,3 +218,21 @@ void Text::Draw(Bitmap& dest, int x, int y, Color color, std::string const& text
 		next_glyph_pos += font->GetSize(glyph).width;
 	}
 }
+
+Text::CacheStats Text::GetCacheStats() {
+	CacheStats stats;
+	stats.hits = runs_hits;
+	stats.misses = runs_misses;
+	stats.entries = runs.size();
+	stats.bytes = runs_bytes;
+	return stats;
+}
+
+void Text::SetCacheLimit(size_t bytes) {
+	runs_limit = bytes;
+	EvictRuns(runs_limit);
+}
+
+void Text::ClearCache() {
+	EvictRuns(0);
+}
@@ -29,11 +29,43 @@ namespace Text {
 		AlignRight
 	};
 
+	/**
+	 * Draws text using a system graphic color on dest.
+	 * Rendered text runs are kept in a LRU cache, so drawing the
+	 * same text again costs a single blit.
+	 */
 	void Draw(Bitmap& dest, int x, int y, int color, std::string const& text, Text::Alignment align = Text::AlignLeft);
 
 	/**
 	 * Draws text using the specified color on dest
 	 */
 	void Draw(Bitmap& dest, int x, int y, Color color, std::string const& text);
+
+	/** Text run cache statistics. */
+	struct CacheStats {
+		unsigned hits;
+		unsigned misses;
+		size_t entries;
+		size_t bytes;
+	};
+
+	/**
+	 * Gets the text run cache statistics.
+	 *
+	 * @return cache statistics.
+	 */
+	CacheStats GetCacheStats();
+
+	/**
+	 * Sets the memory limit of the text run cache.
+	 *
+	 * @param bytes maximum bytes of cached text runs.
+	 */
+	void SetCacheLimit(size_t bytes);
+
+	/**
+	 * Releases all cached text runs.
+	 */
+	void ClearCache();
 }
 #endif
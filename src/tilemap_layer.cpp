@@ -18,6 +18,7 @@
 // Headers
 #include <cstring>
 #include <cmath>
+#include <algorithm>
 #include "tilemap_layer.h"
 #include "graphics.h"
 #include "output.h"
@@ -146,7 +147,10 @@ TilemapLayer::TilemapLayer(int ilayer) :
 	animation_step_c(0),
 	animation_speed(24),
 	animation_type(0),
-	layer(ilayer) {
+	layer(ilayer),
+	draw_buckets_dirty(true),
+	layer_cache_width(0),
+	layer_cache_height(0) {
 
 	memset(autotiles_ab, 0, sizeof(autotiles_ab));
 	memset(autotiles_d, 0, sizeof(autotiles_d));
@@ -155,19 +159,94 @@ TilemapLayer::TilemapLayer(int ilayer) :
 	for (int i = 0; i < tiles_y + 2; i++) {
 		tilemap_tiles.push_back(EASYRPG_MAKE_SHARED<TilemapTile>(this, TILE_SIZE * i));
 	}
+	draw_buckets.resize(tilemap_tiles.size());
 }
 
-void TilemapLayer::DrawTile(Bitmap& screen, int x, int y, int row, int col, bool autotile) {
+void TilemapLayer::DrawTile(Bitmap& dst, Bitmap& screen, int x, int y, int row, int col, bool autotile) {
 	if (!autotile && screen.GetTileOpacity(row, col) == Bitmap::Transparent)
 		return;
 	Rect rect(col * TILE_SIZE, row * TILE_SIZE, TILE_SIZE, TILE_SIZE);
 
-	BitmapRef dst = DisplayUi->GetDisplaySurface();
-	dst->Blit(x, y, screen, rect, 255);
+	dst.Blit(x, y, screen, rect, 255);
 }
 
-void TilemapLayer::Draw(int z_order) {
-	if (!visible) return;
+void TilemapLayer::DrawTileData(Bitmap& dst, short ID, int x, int y) {
+	if (layer == 0) {
+		// If lower layer
+
+		if (ID >= BLOCK_E && ID < BLOCK_E + BLOCK_E_TILES) {
+			int id = substitutions[ID - BLOCK_E];
+			// If Block E
+
+			int row, col;
+
+			// Get the tile coordinates from chipset
+			if (id < 96) {
+				// If from first column of the block
+				col = 12 + id % 6;
+				row = id / 6;
+			} else {
+				// If from second column of the block
+				col = 18 + (id - 96) % 6;
+				row = (id - 96) / 6;
+			}
+
+			DrawTile(dst, *chipset, x, y, row, col, false);
+		} else if (ID >= BLOCK_C && ID < BLOCK_D) {
+			// If Block C
+
+			// Get the tile coordinates from chipset
+			int col = 3 + (ID - BLOCK_C) / 50;
+			int row = 4 + animation_step_c;
+
+			// Draw the tile
+			DrawTile(dst, *chipset, x, y, row, col, false);
+		} else if (ID < BLOCK_C) {
+			// If Blocks A1, A2, B
+
+			// Draw the tile from autotile cache
+			TileXY pos = GetCachedAutotileAB(ID, animation_step_ab);
+			DrawTile(dst, *autotiles_ab_screen, x, y, pos.y, pos.x, true);
+		} else {
+			// If blocks D1-D12
+
+			// Draw the tile from autotile cache
+			TileXY pos = GetCachedAutotileD(ID);
+			DrawTile(dst, *autotiles_d_screen, x, y, pos.y, pos.x, true);
+		}
+	} else {
+		// If upper layer
+
+		// Check that block F is being drawn
+		if (ID >= BLOCK_F && ID < BLOCK_F + BLOCK_F_TILES) {
+			int id = substitutions[ID - BLOCK_F];
+			int row, col;
+
+			// Get the tile coordinates from chipset
+			if (id < 48) {
+				// If from first column of the block
+				col = 18 + id % 6;
+				row = 8 + id / 6;
+			} else {
+				// If from second column of the block
+				col = 24 + (id - 48) % 6;
+				row = (id - 48) / 6;
+			}
+
+			// Draw the tile
+			DrawTile(dst, *chipset, x, y, row, col, false);
+		}
+	}
+}
+
+void TilemapLayer::CreateDrawBuckets() {
+	draw_buckets_dirty = false;
+
+	for (size_t i = 0; i < draw_buckets.size(); ++i) {
+		draw_buckets[i].clear();
+	}
+
+	if (width <= 0 || height <= 0) return;
 
 	// Get the number of tiles that can be displayed on window
 	int tiles_x = (int)ceil(DisplayUi->GetWidth() / (float)TILE_SIZE);
@@ -191,11 +270,8 @@ void TilemapLayer::Draw(int z_order) {
 
 			if (width <= map_x || height <= map_y) continue;
 
-			int map_draw_x = x * TILE_SIZE - ox % TILE_SIZE;
-			int map_draw_y = y * TILE_SIZE - oy % TILE_SIZE;
-
 			// Get the tile data
-			TileData &tile = data_cache[map_x][map_y];
+			const TileData &tile = data_cache[map_x][map_y];
 
 			int map_draw_z = tile.z;
 
@@ -206,77 +282,144 @@ void TilemapLayer::Draw(int z_order) {
 				}
 			}
 
-			// Draw the tile if its z is being draw now
-			if (z_order == map_draw_z) {
-				if (layer == 0) {
-					// If lower layer
-
-					if (tile.ID >= BLOCK_E && tile.ID < BLOCK_E + BLOCK_E_TILES) {
-						int id = substitutions[tile.ID - BLOCK_E];
-						// If Block E
-
-						int row, col;
-
-						// Get the tile coordinates from chipset
-						if (id < 96) {
-							// If from first column of the block
-							col = 12 + id % 6;
-							row = id / 6;
-						} else {
-							// If from second column of the block
-							col = 18 + (id - 96) % 6;
-							row = (id - 96) / 6;
-						}
-
-						DrawTile(*chipset, map_draw_x, map_draw_y, row, col, false);
-					} else if (tile.ID >= BLOCK_C && tile.ID < BLOCK_D) {
-						// If Block C
-
-						// Get the tile coordinates from chipset
-						int col = 3 + (tile.ID - BLOCK_C) / 50;
-						int row = 4 + animation_step_c;
-
-						// Draw the tile
-						DrawTile(*chipset, map_draw_x, map_draw_y, row, col, false);
-					} else if (tile.ID < BLOCK_C) {
-						// If Blocks A1, A2, B
-
-						// Draw the tile from autotile cache
-						TileXY pos = GetCachedAutotileAB(tile.ID, animation_step_ab);
-						DrawTile(*autotiles_ab_screen, map_draw_x, map_draw_y, pos.y, pos.x, true);
-					} else {
-						// If blocks D1-D12
-
-						// Draw the tile from autotile cache
-						TileXY pos = GetCachedAutotileD(tile.ID);
-						DrawTile(*autotiles_d_screen, map_draw_x, map_draw_y, pos.y, pos.x, true);
-					}
-				} else {
-					// If upper layer
-
-					// Check that block F is being drawn
-					if (tile.ID >= BLOCK_F && tile.ID < BLOCK_F + BLOCK_F_TILES) {
-						int id = substitutions[tile.ID - BLOCK_F];
-						int row, col;
-
-						// Get the tile coordinates from chipset
-						if (id < 48) {
-							// If from first column of the block
-							col = 18 + id % 6;
-							row = 8 + id / 6;
-						} else {
-							// If from second column of the block
-							col = 24 + (id - 48) % 6;
-							row = (id - 48) / 6;
-						}
-
-						// Draw the tile
-						DrawTile(*chipset, map_draw_x, map_draw_y, row, col, false);
-					}
-				}
+			// Tiles with z = 0 are drawn from the layer cache
+			if (map_draw_z == 0) continue;
+
+			// Only z values owned by a TilemapTile are ever drawn
+			if (map_draw_z % TILE_SIZE != 0) continue;
+			size_t bucket = map_draw_z / TILE_SIZE;
+			if (bucket >= draw_buckets.size()) continue;
+
+			TileDraw draw;
+			draw.ID = tile.ID;
+			draw.x = x * TILE_SIZE - ox % TILE_SIZE;
+			draw.y = y * TILE_SIZE - oy % TILE_SIZE;
+			draw_buckets[bucket].push_back(draw);
+		}
+	}
+}
+
+void TilemapLayer::Draw(int z_order) {
+	if (!visible) return;
+
+	if (z_order < 0 || z_order % TILE_SIZE != 0) return;
+	size_t bucket = z_order / TILE_SIZE;
+	if (bucket >= draw_buckets.size()) return;
+
+	// Visible tiles are only bucketed again when the view or the map changed
+	if (draw_buckets_dirty) {
+		CreateDrawBuckets();
+	}
+
+	if (bucket == 0) {
+		DrawLayerCache();
+		return;
+	}
+
+	Bitmap& dst = *DisplayUi->GetDisplaySurface();
+	const std::vector<TileDraw>& tiles = draw_buckets[bucket];
+	for (std::vector<TileDraw>::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+		DrawTileData(dst, it->ID, it->x, it->y);
+	}
+}
+
+static inline int PositiveModulo(int value, int divisor) {
+	return ((value % divisor) + divisor) % divisor;
+}
+
+void TilemapLayer::DrawLayerCache() {
+	if (width <= 0 || height <= 0) return;
+
+	// Get the number of tiles that can be displayed on window
+	int tiles_x = (int)ceil(DisplayUi->GetWidth() / (float)TILE_SIZE);
+	int tiles_y = (int)ceil(DisplayUi->GetHeight() / (float)TILE_SIZE);
+
+	if (!layer_cache) {
+		// Room for the extra border tiles drawn when the view is not tile aligned
+		layer_cache_width = tiles_x + 1;
+		layer_cache_height = tiles_y + 1;
+		layer_cache = Bitmap::Create(layer_cache_width * TILE_SIZE, layer_cache_height * TILE_SIZE, true);
+		layer_cache->Clear();
+		layer_cache_cells.assign(layer_cache_width * layer_cache_height, CacheCell());
+	}
+
+	if (ox % TILE_SIZE != 0) {
+		++tiles_x;
+	}
+	if (oy % TILE_SIZE != 0) {
+		++tiles_y;
+	}
+
+	int tile_ox = ox / TILE_SIZE;
+	int tile_oy = oy / TILE_SIZE;
+
+	// Redraw the cells that were scrolled in, changed their animation
+	// step or were invalidated
+	for (int y = 0; y < tiles_y; y++) {
+		for (int x = 0; x < tiles_x; x++) {
+			int map_x = (tile_ox + x + width) % width;
+			int map_y = (tile_oy + y + height) % height;
+
+			if (width <= map_x || height <= map_y) continue;
+
+			const TileData &tile = data_cache[map_x][map_y];
+
+			int step = 0;
+			if (tile.z != 0) {
+				// Drawn by the TilemapTile of its z, keep the cell empty
+				step = -2;
+			} else if (layer == 0 && tile.ID >= BLOCK_C && tile.ID < BLOCK_D) {
+				step = animation_step_c;
+			} else if (layer == 0 && tile.ID < BLOCK_C) {
+				step = animation_step_ab;
+			}
+
+			int cell_x = PositiveModulo(tile_ox + x, layer_cache_width);
+			int cell_y = PositiveModulo(tile_oy + y, layer_cache_height);
+			CacheCell& cell = layer_cache_cells[cell_y * layer_cache_width + cell_x];
+
+			if (cell.map_x == map_x && cell.map_y == map_y && cell.step == step) continue;
+
+			layer_cache->ClearRect(Rect(cell_x * TILE_SIZE, cell_y * TILE_SIZE, TILE_SIZE, TILE_SIZE));
+			if (tile.z == 0) {
+				DrawTileData(*layer_cache, tile.ID, cell_x * TILE_SIZE, cell_y * TILE_SIZE);
 			}
+
+			cell.map_x = map_x;
+			cell.map_y = map_y;
+			cell.step = step;
 		}
 	}
+
+	// Blit the visible cells, split where the ring buffer wraps around
+	Bitmap& dst = *DisplayUi->GetDisplaySurface();
+	int start_x = PositiveModulo(tile_ox, layer_cache_width);
+	int start_y = PositiveModulo(tile_oy, layer_cache_height);
+	int first_w = std::min(tiles_x, layer_cache_width - start_x);
+	int first_h = std::min(tiles_y, layer_cache_height - start_y);
+	int draw_x = -(ox % TILE_SIZE);
+	int draw_y = -(oy % TILE_SIZE);
+
+	const int src_x[2] = { start_x, 0 };
+	const int src_y[2] = { start_y, 0 };
+	const int src_w[2] = { first_w, tiles_x - first_w };
+	const int src_h[2] = { first_h, tiles_y - first_h };
+
+	for (int j = 0; j < 2; j++) {
+		if (src_h[j] <= 0) continue;
+		for (int i = 0; i < 2; i++) {
+			if (src_w[i] <= 0) continue;
+			Rect rect(src_x[i] * TILE_SIZE, src_y[j] * TILE_SIZE,
+					  src_w[i] * TILE_SIZE, src_h[j] * TILE_SIZE);
+			dst.Blit(draw_x + (i == 0 ? 0 : first_w * TILE_SIZE),
+					 draw_y + (j == 0 ? 0 : first_h * TILE_SIZE),
+					 *layer_cache, rect, 255);
+		}
+	}
+}
+
+void TilemapLayer::InvalidateLayerCache() {
+	layer_cache_cells.assign(layer_cache_cells.size(), CacheCell());
 }
 
 TilemapLayer::TileXY TilemapLayer::GetCachedAutotileAB(short ID, short animID) {
@@ -293,6 +436,9 @@ TilemapLayer::TileXY TilemapLayer::GetCachedAutotileD(short ID) {
 }
 
 void TilemapLayer::CreateTileCache(const std::vector<short>& nmap_data) {
+	draw_buckets_dirty = true;
+	InvalidateLayerCache();
+
 	data_cache.resize(width);
 	for (int x = 0; x < width; x++) {
 		data_cache[x].resize(height);
@@ -563,6 +709,7 @@ BitmapRef const& TilemapLayer::GetChipset() const {
 
 void TilemapLayer::SetChipset(BitmapRef const& nchipset) {
 	chipset = nchipset;
+	InvalidateLayerCache();
 	if (autotiles_ab_next != 0 && autotiles_d_screen != 0 && layer == 0) {
 		autotiles_ab_screen = GenerateAutotiles(autotiles_ab_next, autotiles_ab_map);
 		autotiles_d_screen = GenerateAutotiles(autotiles_d_next, autotiles_d_map);
@@ -638,6 +785,7 @@ int TilemapLayer::GetOx() const {
 }
 
 void TilemapLayer::SetOx(int nox) {
+	if (ox != nox) draw_buckets_dirty = true;
 	ox = nox;
 }
 
@@ -646,6 +794,7 @@ int TilemapLayer::GetOy() const {
 }
 
 void TilemapLayer::SetOy(int noy) {
+	if (oy != noy) draw_buckets_dirty = true;
 	oy = noy;
 }
 
@@ -50,7 +50,8 @@ class TilemapLayer {
 public:
 	TilemapLayer(int ilayer);
 
-	void DrawTile(Bitmap& screen, int x, int y, int row, int col, bool autotile);
+	void DrawTile(Bitmap& dst, Bitmap& screen, int x, int y, int row, int col, bool autotile);
+	void DrawTileData(Bitmap& dst, short ID, int x, int y);
 	void Draw(int z_order);
 
 	void Update();
@@ -96,6 +97,9 @@ private:
 	int layer;
 
 	void CreateTileCache(const std::vector<short>& nmap_data);
+	void CreateDrawBuckets();
+	void DrawLayerCache();
+	void InvalidateLayerCache();
 	void GenerateAutotileAB(short ID, short animID);
 	void GenerateAutotileD(short ID);
 
@@ -130,6 +134,33 @@ private:
 		int z;
 	};
 	std::vector<std::vector<TileData> > data_cache;
+
+	/** Visible tile with its screen position, grouped by drawing z. */
+	struct TileDraw {
+		short ID;
+		int x;
+		int y;
+	};
+	/** Visible tiles bucketed by z / TILE_SIZE (one bucket per TilemapTile). */
+	std::vector<std::vector<TileDraw> > draw_buckets;
+	bool draw_buckets_dirty;
+
+	/** Contents of a layer cache cell, used to detect stale cells. */
+	struct CacheCell {
+		int map_x;
+		int map_y;
+		int step;
+		CacheCell() : map_x(-1), map_y(-1), step(-1) {}
+	};
+	/**
+	 * Off-screen surface holding the pre-rendered z = 0 tiles.
+	 * Cells are addressed as a ring buffer in map tile coordinates, so
+	 * scrolling only redraws the newly exposed strip.
+	 */
+	BitmapRef layer_cache;
+	std::vector<CacheCell> layer_cache_cells;
+	int layer_cache_width;
+	int layer_cache_height;
 	std::vector<EASYRPG_SHARED_PTR<TilemapTile> > tilemap_tiles;
 };
 
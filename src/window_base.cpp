@@ -42,6 +42,12 @@ Window_Base::Window_Base(int x, int y, int width, int height) {
 	SetZ(3000);
 }
 
+Window_Base::~Window_Base() {
+	for (face_request_map::iterator it = face_requests.begin(); it != face_requests.end(); ++it) {
+		it->second.first->Unbind(it->second.second);
+	}
+}
+
 void Window_Base::Update() {
 	Window::Update();
 	if (Game_System::GetSystemName() != windowskin_name) {
@@ -52,6 +58,8 @@ void Window_Base::Update() {
 }
 
 void Window_Base::OnFaceReady(FileRequestResult* result, int face_index, int cx, int cy, bool flip) {
+	face_requests.erase(std::make_pair(cx, cy));
+
 	BitmapRef faceset = Cache::Faceset(result->file);
 
 	Rect src_rect(
@@ -70,10 +78,20 @@ void Window_Base::OnFaceReady(FileRequestResult* result, int face_index, int cx,
 }
 
 void Window_Base::DrawFace(const std::string& face_name, int face_index, int cx, int cy, bool flip) {
+	// Drawing again at the same place, e.g. on a second Refresh, replaces
+	// a face that is still loading instead of drawing both
+	std::pair<int, int> const position(cx, cy);
+	face_request_map::iterator it = face_requests.find(position);
+	if (it != face_requests.end()) {
+		it->second.first->Unbind(it->second.second);
+		face_requests.erase(it);
+	}
+
 	if (face_name.empty()) { return; }
 
 	FileRequestAsync* request = AsyncHandler::RequestFile("FaceSet", face_name);
-	request->Bind(boost::bind(&Window_Base::OnFaceReady, this, _1, face_index, cx, cy, flip));
+	int const id = request->Bind(boost::bind(&Window_Base::OnFaceReady, this, _1, face_index, cx, cy, flip));
+	face_requests[position] = std::make_pair(request, id);
 	request->Start();
 }
 
@@ -19,11 +19,16 @@
 #define _WINDOW_BASE_H_
 
 // Headers
+#include <map>
 #include <string>
+#include <utility>
 #include "window.h"
 #include "game_actor.h"
 #include "main_data.h"
 
+class FileRequestAsync;
+struct FileRequestResult;
+
 /**
  * Window Base class.
  */
@@ -39,6 +44,11 @@ public:
 	 */
 	Window_Base(int x, int y, int width, int height);
 
+	/**
+	 * Destructor.
+	 */
+	~Window_Base();
+
 	/**
 	 * Updates the window.
 	 */
@@ -70,6 +80,11 @@ protected:
 	void OnFaceReady(FileRequestResult* result, int face_index, int cx, int cy, bool flip);
 
 	std::string windowskin_name;
+
+	typedef std::map<std::pair<int, int>, std::pair<FileRequestAsync*, int> > face_request_map;
+
+	/** Faces still loading by position, with their request and bind id. */
+	face_request_map face_requests;
 };
 
 #endif
@@ -16,6 +16,7 @@
  */
 
 // Headers
+#include <algorithm>
 #include <boost/bind.hpp>
 #include "async_handler.h"
 #include "bitmap.h"
@@ -35,17 +36,27 @@ Window_ShopParty::Window_ShopParty(int ix, int iy, int iwidth, int iheight) :
 	cycle = 0;
 	item_id = 0;
 
+	std::fill(requests, requests + 4, (FileRequestAsync*) NULL);
+
 	const std::vector<Game_Actor*>& actors = Main_Data::game_party->GetActors();
 	for (size_t i = 0; i < actors.size() && i < 4; i++) {
 		const std::string& sprite_name = actors[i]->GetSpriteName();
-		FileRequestAsync* request = AsyncHandler::RequestFile("CharSet", sprite_name);
-		request->Bind(boost::bind(&Window_ShopParty::OnCharsetSpriteReady, this, _1, (int)i));
-		request->Start();
+		requests[i] = AsyncHandler::RequestFile("CharSet", sprite_name);
+		request_ids[i] = requests[i]->Bind(boost::bind(&Window_ShopParty::OnCharsetSpriteReady, this, _1, (int)i));
+		requests[i]->Start();
 	}
 
 	Refresh();
 }
 
+Window_ShopParty::~Window_ShopParty() {
+	for (int i = 0; i < 4; i++) {
+		if (requests[i]) {
+			requests[i]->Unbind(request_ids[i]);
+		}
+	}
+}
+
 void Window_ShopParty::Refresh() {
 	contents->Clear();
 
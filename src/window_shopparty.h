@@ -22,6 +22,7 @@
 #include "window_base.h"
 #include "bitmap.h"
 
+class FileRequestAsync;
 struct FileRequestResult;
 
 /**
@@ -35,6 +36,11 @@ public:
 	 */
 	Window_ShopParty(int ix, int iy, int iwidth, int iheight);
 
+	/**
+	 * Destructor.
+	 */
+	~Window_ShopParty();
+
 	/**
 	 * Renders the current party on the window.
 	 */
@@ -62,6 +68,10 @@ protected:
 	 */
 	BitmapRef bitmaps[4][3][2];
 
+	/** Charset requests of the actors and their bind ids. */
+	FileRequestAsync* requests[4];
+	int request_ids[4];
+
 	void OnCharsetSpriteReady(FileRequestResult* result, int party_index);
 
 	/** Animation rate. */
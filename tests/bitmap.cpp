@@ -0,0 +1,53 @@
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "bitmap.h"
+
+static const int src_size = 8;
+static const int dst_size = 32;
+
+// Colors of r5g6b5 expand to the same 32 bit value in both paths
+static std::vector<uint16_t> MakeSource() {
+	std::vector<uint16_t> pixels(src_size * src_size);
+	for (int y = 0; y < src_size; y++) {
+		for (int x = 0; x < src_size; x++) {
+			pixels[y * src_size + x] = (uint16_t) (((x * 4) << 11) | ((y * 8) << 5) | (x + y));
+		}
+	}
+	return pixels;
+}
+
+static void WaverBlitMatchesPixman(double zoom, int depth, double phase) {
+	const DynamicFormat format_32(32,8,16,8,8,8,0,8,24,PF::Alpha);
+	const DynamicFormat format_16(16,5,11,6,5,5,0,0,0,PF::NoAlpha);
+
+	std::vector<uint16_t> source = MakeSource();
+	std::vector<uint32_t> source_32(src_size * src_size, 0);
+	BitmapRef src_16 = Bitmap::Create(&source[0], src_size, src_size, src_size * 2, format_16);
+	BitmapRef src_32 = Bitmap::Create(&source_32[0], src_size, src_size, src_size * 4, format_32);
+	src_32->Blit(0, 0, *src_16, src_16->GetRect(), Opacity::opaque);
+
+	// A 16 bit source is not handled by the fast path
+	std::vector<uint32_t> fast(dst_size * dst_size, 0);
+	std::vector<uint32_t> composite(dst_size * dst_size, 0);
+	BitmapRef dst_fast = Bitmap::Create(&fast[0], dst_size, dst_size, dst_size * 4, format_32);
+	BitmapRef dst_composite = Bitmap::Create(&composite[0], dst_size, dst_size, dst_size * 4, format_32);
+
+	Rect const src_rect(1, 2, 6, 5);
+	dst_fast->WaverBlit(4, 3, zoom, zoom, *src_32, src_rect, depth, phase, src_rect.y, Opacity::opaque);
+	dst_composite->WaverBlit(4, 3, zoom, zoom, *src_16, src_rect, depth, phase, src_rect.y, Opacity::opaque);
+
+	assert(fast == composite);
+}
+
+extern "C" int main(int, char**) {
+	Bitmap::SetFormat(Bitmap::ChooseFormat(DynamicFormat(32,8,16,8,8,8,0,8,24,PF::Alpha)));
+
+	WaverBlitMatchesPixman(1.0, 0, 0.0);
+	WaverBlitMatchesPixman(0.5, 0, 0.0);
+	WaverBlitMatchesPixman(2.0, 2, 45.0);
+	WaverBlitMatchesPixman(1.5, 1, 90.0);
+
+	return EXIT_SUCCESS;
+}
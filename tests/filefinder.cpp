@@ -3,6 +3,13 @@
 #include "player.h"
 #include "reader_util.h"
 #include "main_data.h"
+#include "utils.h"
+
+#ifdef _MSC_VER
+#  include "rtp_table_bom.h"
+#else
+#  include "rtp_table.h"
+#endif
 
 namespace {
 
@@ -20,6 +27,79 @@ namespace {
 		assert(!FileFinder::FindImage("Backdrop", "castle").empty());
 	}
 
+	void CheckLookupCaseInsensitive() {
+		std::string const path = FileFinder::FindImage("Backdrop", "castle");
+		FileFinder::LookupStats const before = FileFinder::GetLookupStats();
+
+		assert(FileFinder::FindImage("BACKDROP", "Castle") == path);
+
+		FileFinder::LookupStats const after = FileFinder::GetLookupStats();
+		assert(after.hits == before.hits + 1);
+		assert(after.entries == before.entries);
+	}
+
+	void CheckLookupMiss() {
+		FileFinder::LookupStats const before = FileFinder::GetLookupStats();
+
+		assert(FileFinder::FindImage("Backdrop", "no such image").empty());
+		FileFinder::LookupStats const missed = FileFinder::GetLookupStats();
+		assert(missed.entries == before.entries + 1);
+
+		assert(FileFinder::FindImage("backdrop", "NO SUCH IMAGE").empty());
+		FileFinder::LookupStats const after = FileFinder::GetLookupStats();
+		assert(after.hits == missed.hits + 1);
+		assert(after.entries == missed.entries);
+	}
+
+	void CheckLookupTreeRebuild() {
+		FileFinder::FindImage("Backdrop", "castle");
+		assert(FileFinder::GetLookupStats().entries > 0);
+
+		// Init rebuilds the project tree
+		FileFinder::Init();
+		assert(FileFinder::GetLookupStats().entries == 0);
+	}
+
+	// The linear search the reverse table replaced
+	std::string const& LinearTranslateRtp(rtp_table_type const& table, std::string const& dir, std::string const& name) {
+		rtp_table_type::const_iterator dir_it = table.find(Utils::LowerCase(dir));
+		std::string lower_name = Utils::LowerCase(name);
+
+		if (dir_it == table.end()) { return name; }
+
+		std::map<std::string, std::string>::const_iterator file_it =
+			dir_it->second.find(lower_name);
+		if (file_it == dir_it->second.end()) {
+			bool ascii = true;
+			for (std::string::const_iterator c = lower_name.begin(); c != lower_name.end(); ++c) {
+				ascii = ascii && (uint8_t) *c <= 0x80;
+			}
+			if (!ascii) {
+				for (std::map<std::string, std::string>::const_iterator it = dir_it->second.begin(); it != file_it; ++it) {
+					if (it->second == lower_name) {
+						return it->first;
+					}
+				}
+			}
+			return name;
+		}
+		return file_it->second;
+	}
+
+	void CheckRtpTranslation(Player::EngineType engine, rtp_table_type const& table) {
+		Player::engine = engine;
+
+		for (rtp_table_type::const_iterator dir_it = table.begin(); dir_it != table.end(); ++dir_it) {
+			std::string const& dir = dir_it->first;
+			for (std::map<std::string, std::string>::const_iterator it = dir_it->second.begin(); it != dir_it->second.end(); ++it) {
+				assert(FileFinder::TranslateRtp(dir, it->first) == LinearTranslateRtp(table, dir, it->first));
+				assert(FileFinder::TranslateRtp(dir, it->second) == LinearTranslateRtp(table, dir, it->second));
+			}
+		}
+
+		Player::engine = Player::EngineRpg2k;
+	}
+
 }
 
 int main(int, char**) {
@@ -33,6 +113,11 @@ int main(int, char**) {
 	CheckIsDirectory();
 	CheckIsRPG2kProject();
 	CheckEnglishFilename();
+	CheckLookupCaseInsensitive();
+	CheckLookupMiss();
+	CheckLookupTreeRebuild();
+	CheckRtpTranslation(Player::EngineRpg2k, RTP_TABLE_2000);
+	CheckRtpTranslation(Player::EngineRpg2k3, RTP_TABLE_2003);
 
 	FileFinder::Quit();
 